@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui charts
+QT       += core gui charts concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -22,20 +22,46 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# S-parameter samples are stored in single precision with CONFIG += float_samples,
+# frequencies stay in double precision
+float_samples: DEFINES += SNP_FLOAT_SAMPLES
+
 
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
     filesnpdata.cpp \
     fielddelegate.cpp \
-    charteditmodel.cpp
+    charteditmodel.cpp \
+    chartnavigator.cpp \
+    complexgridlayer.cpp \
+    snpparser.cpp \
+    snpcache.cpp \
+    sparameterdata.cpp \
+    decimation.cpp \
+    displayformat.cpp \
+    networkconversion.cpp \
+    resampling.cpp \
+    markerlayer.cpp \
+    rastertracelayer.cpp
 
 HEADERS += \
         mainwindow.h \
     filesnpdata.h \
     fielddelegate.h \
     charteditmodel.h \
-    chartconfiguration.h
+    chartnavigator.h \
+    complexgridlayer.h \
+    chartconfiguration.h \
+    snpparser.h \
+    snpcache.h \
+    sparameterdata.h \
+    decimation.h \
+    displayformat.h \
+    networkconversion.h \
+    resampling.h \
+    markerlayer.h \
+    rastertracelayer.h
 
 FORMS += \
         mainwindow.ui
@@ -0,0 +1,9 @@
+# Benchmarks of the viewer, built separately from Chart.pro:
+#   qmake benchmarks/benchmarks.pro && make
+# Every benchmark prints its results, its arguments are described at the top of its main.cpp.
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    parserbenchmark \
+    seriesbenchmark
@@ -0,0 +1,179 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "snpparser.h"
+
+// Checks that SNPParser reads the same numbers as QTextStream, which FileSNPData used before,
+// and times both on a big data section.
+//
+// usage: parserbenchmark [megabytes] [file...]
+// Every file (the bundled .sNp files by default) is read both ways and has to give the same
+// numbers bit for bit, sequentially and split into pieces like FileSNPData::readData does.
+// The data section of the first file is then repeated to `megabytes` (256 by default) and timed.
+// The exit code is 1 if any file differs.
+
+namespace
+{
+
+const char* const DEFAULT_FILES[] = {
+    DATA_DIR "/dataFileA.s4p", DATA_DIR "/dataFileC.s4p", DATA_DIR "/dataFileD.s3p"
+};
+const int DEFAULT_MEGABYTES = 256;
+
+// network data of a file, the part after the header read by SNPParser
+QByteArray readDataSection(QString path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        throw std::runtime_error(QString("Cannot open %1").arg(path).toStdString());
+    const QByteArray text = file.readAll();
+    SNPParser parser(text.constData(), text.constData() + text.size());
+    parser.readHeader();
+    return text.mid(static_cast<int>(parser.offset()), static_cast<int>(parser.remaining()));
+}
+
+// numbers read by QTextStream, line by line so '!' comments can be cut off
+std::vector<qreal> readWithTextStream(const QByteArray& data)
+{
+    std::vector<qreal> result;
+    QTextStream in(data);
+    QString line;
+    while (in.readLineInto(&line))
+    {
+        const int comment = line.indexOf('!');
+        if (comment != -1)
+            line.truncate(comment);
+        QTextStream numbers(&line);
+        qreal value;
+        forever
+        {
+            numbers >> value;
+            if (numbers.status() != QTextStream::Ok)
+                break;
+            result.push_back(value);
+        }
+    }
+    return result;
+}
+
+std::vector<qreal> readWithParser(const QByteArray& data)
+{
+    std::vector<qreal> result;
+    SNPParser parser(data.constData(), data.constData() + data.size());
+    qreal value;
+    while (parser.readNumber(value))
+        result.push_back(value);
+    return result;
+}
+
+// pieces are counted and parsed in parallel, then joined in order
+std::vector<qreal> readWithParserPieces(const QByteArray& data)
+{
+    SNPParser parser(data.constData(), data.constData() + data.size());
+    struct Piece
+    {
+        SNPParser parser;
+        std::vector<qreal> numbers;
+    };
+    std::vector<Piece> pieces;
+    for (const SNPParser& piece : parser.split(4 * QThread::idealThreadCount()))
+        pieces.push_back({piece, std::vector<qreal>()});
+    QtConcurrent::blockingMap(pieces, [](Piece& piece) {
+        piece.numbers.reserve(piece.parser.countNumbers());
+        qreal value;
+        while (piece.parser.readNumber(value))
+            piece.numbers.push_back(value);
+    });
+
+    std::vector<qreal> result;
+    for (const Piece& piece : pieces)
+        result.insert(result.end(), piece.numbers.cbegin(), piece.numbers.cend());
+    return result;
+}
+
+// index of the first number that differs bit for bit, -1 if there is none
+qint64 firstDifference(const std::vector<qreal>& numbers, const std::vector<qreal>& other)
+{
+    for (size_t i = 0; i < qMin(numbers.size(), other.size()); ++i)
+    {
+        if (std::memcmp(&numbers[i], &other[i], sizeof(qreal)) != 0)
+            return static_cast<qint64>(i);
+    }
+    return numbers.size() == other.size() ? -1 : static_cast<qint64>(qMin(numbers.size(), other.size()));
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList arguments = app.arguments();
+    arguments.removeFirst();
+    const int megabytes = arguments.isEmpty() ? DEFAULT_MEGABYTES : arguments.takeFirst().toInt();
+    if (arguments.isEmpty())
+    {
+        for (const char* file : DEFAULT_FILES)
+            arguments.push_back(file);
+    }
+
+    QTextStream out(stdout);
+    bool equal = true;
+    try
+    {
+        for (const QString& path : arguments)
+        {
+            const QByteArray data = readDataSection(path);
+            const std::vector<qreal> reference = readWithTextStream(data);
+            const qint64 sequential = firstDifference(reference, readWithParser(data));
+            const qint64 pieces = firstDifference(reference, readWithParserPieces(data));
+            out << path << ": " << reference.size() << " numbers, ";
+            if (sequential == -1 && pieces == -1)
+                out << "equal\n";
+            else
+                out << "differ at number " << (sequential != -1 ? sequential : pieces) << "\n";
+            equal = equal && sequential == -1 && pieces == -1;
+        }
+
+        const QByteArray section = readDataSection(arguments.first());
+        QByteArray data;
+        data.reserve(megabytes * 1024 * 1024 + section.size());
+        while (data.size() < megabytes * 1024 * 1024)
+            data += section;
+        const qreal size = data.size() / (1024.0 * 1024.0);
+
+        QElapsedTimer timer;
+        timer.start();
+        readWithTextStream(data);
+        const qreal textStream = timer.nsecsElapsed() / 1e9;
+        timer.start();
+        readWithParser(data);
+        const qreal parser = timer.nsecsElapsed() / 1e9;
+        timer.start();
+        readWithParserPieces(data);
+        const qreal parserPieces = timer.nsecsElapsed() / 1e9;
+
+        out << QString("%1 MB of %2:\n").arg(size, 0, 'f', 0).arg(arguments.first());
+        out << QString("  QTextStream          %1 s  %2 MB/s\n")
+               .arg(textStream, 0, 'f', 2).arg(size / textStream, 0, 'f', 0);
+        out << QString("  SNPParser            %1 s  %2 MB/s  %3x\n")
+               .arg(parser, 0, 'f', 2).arg(size / parser, 0, 'f', 0).arg(textStream / parser, 0, 'f', 1);
+        out << QString("  SNPParser, %1 threads %2 s  %3 MB/s  %4x\n").arg(QThread::idealThreadCount())
+               .arg(parserPieces, 0, 'f', 2).arg(size / parserPieces, 0, 'f', 0).arg(textStream / parserPieces, 0, 'f', 1);
+    }
+    catch (const std::exception& e)
+    {
+        out << e.what() << "\n";
+        return 1;
+    }
+    out.flush();
+    return equal ? 0 : 1;
+}
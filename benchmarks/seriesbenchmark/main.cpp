@@ -0,0 +1,186 @@
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRegExp>
+#include <QStringList>
+#include <QTextStream>
+#include <QtCharts/QChart>
+#include <QtCharts/QChartView>
+#include <QtCharts/QLineSeries>
+#include <QtCharts/QSplineSeries>
+
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "snpparser.h"
+
+QT_CHARTS_USE_NAMESPACE
+
+// Times how long a trace takes from a point buffer to the screen, with the way traces were drawn
+// before (a QSplineSeries filled by append() per point) and the way FileSNPData::createSeries draws
+// them now (one replace() of the whole buffer, QLineSeries unless smoothing is turned on).
+//
+// usage: seriesbenchmark [file] [points], without a display run it with -platform offscreen
+// The trace is the first number of the second parameter of every record, repeated with shifted
+// frequencies until it has the requested number of points.
+
+namespace
+{
+
+const char* const DEFAULT_FILE = DATA_DIR "/dataFileC.s4p";
+const int DEFAULT_POINTS = 200000;
+// every method is run this many times, the fastest run counts
+const int RUNS = 3;
+
+struct Method
+{
+    QString name;
+    std::function<QXYSeries*(const QVector<QPointF>&)> create;
+};
+
+struct Timing
+{
+    // creating and filling the series
+    qreal fill = std::numeric_limits<qreal>::max();
+    // adding it to the chart and painting the chart once
+    qreal draw = std::numeric_limits<qreal>::max();
+};
+
+QVector<QPointF> readTrace(QString path, int points)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        throw std::runtime_error(QString("Cannot open %1").arg(path).toStdString());
+    const QByteArray data = file.readAll();
+    SNPParser parser(data.constData(), data.constData() + data.size());
+    const SNPHeader header = parser.readHeader();
+
+    int ports = header.ports;
+    QRegExp extension("\\.s(\\d+)p$", Qt::CaseInsensitive);
+    if (ports == 0 && extension.indexIn(path) != -1)
+        ports = extension.cap(1).toInt();
+    if (ports == 0 || header.matrixFormat != SNPHeader::MatrixFormat::Full)
+        throw std::runtime_error("Only full matrices of .sNp files are supported");
+
+    std::vector<qreal> numbers;
+    qreal value;
+    while (parser.readNumber(value))
+        numbers.push_back(value);
+    const int recordSize = 1 + 2 * ports * ports;
+    const int records = static_cast<int>(numbers.size()) / recordSize;
+    if (records < 2)
+        throw std::runtime_error("The file needs at least two records");
+
+    QVector<QPointF> record;
+    for (int i = 0; i < records; ++i)
+        record.push_back(QPointF(numbers[i * recordSize] * header.options.frequencyScale, numbers[i * recordSize + 3]));
+
+    // copies follow each other with the step of the last two records
+    const qreal span = record.last().x() - record.first().x() + record.last().x() - record.at(records - 2).x();
+    QVector<QPointF> result;
+    result.reserve(points);
+    for (int i = 0; i < points; ++i)
+    {
+        const QPointF& point = record.at(i % records);
+        result.push_back(QPointF(point.x() + (i / records) * span, point.y()));
+    }
+    return result;
+}
+
+template <typename Series>
+QXYSeries* appendPoints(const QVector<QPointF>& points)
+{
+    QXYSeries* series = new Series;
+    for (const QPointF& point : points)
+        series->append(point);
+    return series;
+}
+
+template <typename Series>
+QXYSeries* replacePoints(const QVector<QPointF>& points)
+{
+    QXYSeries* series = new Series;
+    series->replace(points);
+    return series;
+}
+
+Timing measure(const Method& method, const QVector<QPointF>& points, QChartView& view)
+{
+    Timing result;
+    QElapsedTimer timer;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        timer.start();
+        QXYSeries* series = method.create(points);
+        result.fill = qMin(result.fill, timer.nsecsElapsed() / 1e6);
+
+        timer.start();
+        view.chart()->addSeries(series);
+        view.chart()->createDefaultAxes();
+        view.grab();
+        result.draw = qMin(result.draw, timer.nsecsElapsed() / 1e6);
+
+        view.chart()->removeSeries(series);
+        delete series;
+    }
+    return result;
+}
+
+// method name and its numbers as one line of a table
+QString row(const QStringList& cells)
+{
+    QString result = cells.first().leftJustified(44);
+    for (int i = 1; i < cells.size(); ++i)
+        result += cells.at(i).rightJustified(12);
+    return result + "\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QApplication app(argc, argv);
+    const QStringList arguments = app.arguments();
+    const QString path = arguments.size() > 1 ? arguments.at(1) : QString(DEFAULT_FILE);
+    const int points = arguments.size() > 2 ? arguments.at(2).toInt() : DEFAULT_POINTS;
+
+    QTextStream out(stdout);
+    QVector<QPointF> trace;
+    try
+    {
+        trace = readTrace(path, points);
+    }
+    catch (const std::exception& e)
+    {
+        out << e.what() << "\n";
+        return 1;
+    }
+
+    QChartView view;
+    view.resize(1280, 800);
+    view.setRenderHint(QPainter::Antialiasing);
+
+    const Method methods[] = {
+        {"QSplineSeries, append per point (before)", appendPoints<QSplineSeries>},
+        {"QLineSeries, append per point", appendPoints<QLineSeries>},
+        {"QSplineSeries, replace (Smooth Lines)", replacePoints<QSplineSeries>},
+        {"QLineSeries, replace (default)", replacePoints<QLineSeries>}
+    };
+
+    out << path << ", " << trace.size() << " points, best of " << RUNS << " runs\n";
+    out << row({"method", "fill ms", "draw ms", "total ms", "speedup"});
+    qreal baseline = 0;
+    for (const Method& method : methods)
+    {
+        const Timing timing = measure(method, trace, view);
+        const qreal total = timing.fill + timing.draw;
+        if (baseline == 0)
+            baseline = total;
+        out << row({method.name, QString::number(timing.fill, 'f', 1), QString::number(timing.draw, 'f', 1),
+                    QString::number(total, 'f', 1), QString::number(baseline / total, 'f', 1) + "x"});
+    }
+    out.flush();
+    return 0;
+}
@@ -0,0 +1,18 @@
+QT       += core gui widgets charts
+
+TARGET = seriesbenchmark
+TEMPLATE = app
+CONFIG += console
+
+DEFINES += QT_DEPRECATED_WARNINGS
+# bundled data files, the default input of the benchmark
+DEFINES += DATA_DIR=\\\"$$PWD/../..\\\"
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    main.cpp \
+    ../../snpparser.cpp
+
+HEADERS += \
+    ../../snpparser.h
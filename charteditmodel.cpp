@@ -7,6 +7,17 @@
 #include <QIcon>
 #include <QLabel>
 #include <QCursor>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <limits>
+
+namespace
+{
+
+// space around the outer circle of the complex plane
+const qreal COMPLEX_MARGIN = 1.1;
+
+} // namespace
 
 QT_CHARTS_USE_NAMESPACE
 
@@ -22,20 +33,35 @@ const std::map<ChartEditModel::NodeType, QString> ChartEditModel::TYPE_TO_STRING
     {ChartEditModel::NodeType::xGrid,           "X Grid Number"},
     {ChartEditModel::NodeType::yGrid,           "Y Grid Number"},
     {ChartEditModel::NodeType::Legend,          "Show Legend"},
+    {ChartEditModel::NodeType::SmoothLines,     "Smooth Lines"},
+    {ChartEditModel::NodeType::OverlayFiles,    "Overlay Files"},
+    {ChartEditModel::NodeType::RasterRendering, "Raster Rendering"},
+    {ChartEditModel::NodeType::View,            "View"},
+    {ChartEditModel::NodeType::Interpolation,   "Interpolation"},
     {ChartEditModel::NodeType::FileName,        "Name"},
     {ChartEditModel::NodeType::FilePath,        "Path"},
     {ChartEditModel::NodeType::Columns,         "Columns"},
     {ChartEditModel::NodeType::LineWidth,       "Line Width"},
     {ChartEditModel::NodeType::LineColor,       "Line Color"},
     {ChartEditModel::NodeType::Multiplier,      "Multiplier"},
-    {ChartEditModel::NodeType::Z0,              "Z0"}
+    {ChartEditModel::NodeType::Format,          "Format"},
+    {ChartEditModel::NodeType::Aperture,        "Group Delay Aperture"},
+    {ChartEditModel::NodeType::Network,         "Network"},
+    {ChartEditModel::NodeType::PortPairs,       "Port Pairs"},
+    {ChartEditModel::NodeType::Z0,              "Z0"},
+    {ChartEditModel::NodeType::FrequencyRange,  "Frequency Range"}
 };
 
 ChartEditModel::ChartEditModel(QChart *chart, QObject *parent)
     : QAbstractItemModel(parent)
     , chart(chart)
     , cc(1)
+    , smoothLines(false)
+    , overlayFiles(false)
+    , rasterRendering(false)
+    , view(ChartView::Rectangular)
     , selectedFile(-1)
+    , interpolation(Interpolation::Linear)
 {
     Node* config = new Node(this, NodeType::Configuration);
     config->children
@@ -48,15 +74,69 @@ ChartEditModel::ChartEditModel(QChart *chart, QObject *parent)
         << new Node(this, NodeType::yMax,       config)
         << new Node(this, NodeType::xGrid,      config)
         << new Node(this, NodeType::yGrid,      config)
-        << new Node(this, NodeType::Legend,     config);
+        << new Node(this, NodeType::Legend,     config)
+        << new Node(this, NodeType::SmoothLines, config)
+        << new Node(this, NodeType::OverlayFiles, config)
+        << new Node(this, NodeType::RasterRendering, config)
+        << new Node(this, NodeType::View,       config)
+        << new Node(this, NodeType::Interpolation, config);
 
     tree.push_back(config);
 
-    coordinatesLabel = new QGraphicsTextItem(chart);
+    // readout of the traces under the cursor and placed markers, above the traces
+    markerLayer = new MarkerLayer(chart);
+    markerLayer->setZValue(6);
+    markerLayer->setReadout([this](qreal frequency) { return readTraces(frequency); });
+    connect(static_cast<QValueAxis*>(chart->axisX()), &QValueAxis::rangeChanged,
+            markerLayer, &MarkerLayer::refresh);
+    connect(static_cast<QValueAxis*>(chart->axisY()), &QValueAxis::rangeChanged,
+            markerLayer, &MarkerLayer::refresh);
+    connect(chart, &QChart::plotAreaChanged,
+            markerLayer, &MarkerLayer::refresh);
+
+    // gridlines of polar and Smith charts, the complex plane keeps its aspect ratio
+    gridLayer = new ComplexGridLayer(chart);
+    gridLayer->setZValue(2);
+    connect(static_cast<QValueAxis*>(chart->axisX()), &QValueAxis::rangeChanged,
+            gridLayer, &ComplexGridLayer::refresh);
+    connect(static_cast<QValueAxis*>(chart->axisY()), &QValueAxis::rangeChanged,
+            gridLayer, &ComplexGridLayer::refresh);
+    connect(chart, &QChart::plotAreaChanged,
+            this, &ChartEditModel::keepComplexAspect);
+
+    // decimated series are rebuilt for the visible range and size of the plot
+    connect(static_cast<QValueAxis*>(chart->axisX()), &QValueAxis::rangeChanged,
+            this, &ChartEditModel::updateLevelOfDetail);
+    connect(chart, &QChart::plotAreaChanged,
+            this, &ChartEditModel::updateLevelOfDetail);
+
+    // only the fields of the axis that changed are refreshed, e.g. while zooming
+    connect(static_cast<QValueAxis*>(chart->axisX()), &QValueAxis::rangeChanged,
+            this, [this]() { configChanged(NodeType::xMin, NodeType::xMax); });
+    connect(static_cast<QValueAxis*>(chart->axisY()), &QValueAxis::rangeChanged,
+            this, [this]() { configChanged(NodeType::yMin, NodeType::yMax); });
+
+    // in raster mode series stay hidden and their points are drawn by the layer
+    rasterLayer = new RasterTraceLayer(chart);
+    rasterLayer->setZValue(1);
+    rasterLayer->hide();
+    connect(static_cast<QValueAxis*>(chart->axisY()), &QValueAxis::rangeChanged,
+            this, &ChartEditModel::updateRasterLayer);
+
+    // loading progress is polled, so worker threads never touch the model
+    progressTimer = new QTimer(this);
+    progressTimer->setInterval(100);
+    connect(progressTimer, &QTimer::timeout, this, &ChartEditModel::updateLoadingProgress);
 }
 
 ChartEditModel::~ChartEditModel()
 {
+    for (const PendingLoad& load : pendingLoads)
+    {
+        load.control->cancelled = true;
+        disconnect(load.watcher, nullptr, this, nullptr);
+    }
+
     for (auto node : tree)
         delete node;
 }
@@ -125,11 +205,29 @@ QVariant ChartEditModel::data(const QModelIndex &index, int role) const
     if (role == Qt::DisplayRole)
     {
         if (node->type == NodeType::FileName)
-            return files.at(row(node) - 1).getFileName();
+        {
+            // loaded files are being reloaded when their frequency range changes
+            const FileSNPData& file = files.at(row(node) - 1);
+            auto load = pendingLoads.find(file.getFilePath());
+            if (load == pendingLoads.end())
+                return file.getFileName();
+
+            int progress = load->control->progress.load();
+            return file.getFileName() + " (loading " + QString::number(progress) + "%)";
+        }
         if (node->type == NodeType::FilePath)
             return files.at(row(parent(node)) - 1).getFilePath();
         if (node->type == NodeType::Z0)
-            return "Z0 = " + QString::number(files.at(row(parent(node)) - 1).getZ0());
+        {
+            // ports of Touchstone 2.0 files may have different impedances
+            QStringList impedances;
+            for (qreal impedance : files.at(row(parent(node)) - 1).getReferenceImpedances())
+            {
+                if (!impedances.contains(QString::number(impedance)))
+                    impedances.push_back(QString::number(impedance));
+            }
+            return "Z0 = " + impedances.join(", ");
+        }
 
         QString result = TYPE_TO_STRING.at(node->type);
         return result;
@@ -167,6 +265,21 @@ QVariant ChartEditModel::data(const QModelIndex &index, int role) const
         case NodeType::Legend:
             return QVariant(chart->legend()->isVisible());
             break;
+        case NodeType::SmoothLines:
+            return QVariant(smoothLines);
+            break;
+        case NodeType::OverlayFiles:
+            return QVariant(overlayFiles);
+            break;
+        case NodeType::RasterRendering:
+            return QVariant(rasterRendering);
+            break;
+        case NodeType::View:
+            return QVariant(chartViewToString(view));
+            break;
+        case NodeType::Interpolation:
+            return QVariant(interpolationToString(interpolation));
+            break;
         case NodeType::Columns:
             return listToStringColumns(files.at(row(parent(node)) - 1).getColumns());
             break;
@@ -179,6 +292,21 @@ QVariant ChartEditModel::data(const QModelIndex &index, int role) const
         case NodeType::Multiplier:
             return files.at(row(parent(node)) - 1).getMultiplier();
             break;
+        case NodeType::Format:
+            return displayFormatToString(files.at(row(parent(node)) - 1).getDisplayFormat());
+            break;
+        case NodeType::Aperture:
+            return files.at(row(parent(node)) - 1).getAperture();
+            break;
+        case NodeType::Network:
+            return networkTypeToString(files.at(row(parent(node)) - 1).getNetwork());
+            break;
+        case NodeType::PortPairs:
+            return listToStringColumns(files.at(row(parent(node)) - 1).getPortPairs());
+            break;
+        case NodeType::FrequencyRange:
+            return frequencyRangeToString(files.at(row(parent(node)) - 1).getFrequencyRange());
+            break;
         }
 
         return QVariant();
@@ -231,11 +359,62 @@ bool ChartEditModel::setData(const QModelIndex& index, const QVariant& value, in
     case NodeType::Legend:
         chart->legend()->setVisible(value.toBool());
         break;
+    case NodeType::SmoothLines:
+        smoothLines = value.toBool();
+        drawLines();
+        break;
+    case NodeType::OverlayFiles:
+        overlayFiles = value.toBool();
+        drawLines();
+        break;
+    case NodeType::RasterRendering:
+        rasterRendering = value.toBool();
+        updateRasterLayer();
+        break;
+    case NodeType::View:
+    {
+        bool ok;
+        ChartView chartView = stringToChartView(value.toString(), &ok);
+        if (!ok)
+            return false;
+        view = chartView;
+        // axes of the complex plane are fitted by drawLines
+        chart->axisX()->setVisible(view == ChartView::Rectangular);
+        chart->axisY()->setVisible(view == ChartView::Rectangular);
+        gridLayer->setView(view);
+        markerLayer->setFrequencyAxis(view == ChartView::Rectangular);
+        drawLines();
+        if (view != ChartView::Rectangular && drawn.isEmpty())
+            fitComplexAxes();
+        break;
+    }
+    case NodeType::Interpolation:
+    {
+        bool ok;
+        Interpolation selected = stringToInterpolation(value.toString(), &ok);
+        if (!ok)
+            return false;
+        interpolation = selected;
+        // virtual files are resampled again once they are drawn
+        for (VirtualFile& definition : virtualFiles)
+            definition.outdated = true;
+        drawLines();
+        break;
+    }
     case NodeType::Columns:
+    {
+        QList<std::pair<int, int>> columns = stringToListColumns(value.toString());
+        FileSNPData& file = files[row(parent(node)) - 1];
+        if (!file.isValidColumns(columns))
+        {
+            emit dataChanged(index, index);
+            return false;
+        }
         selectedFile = row(parent(node)) - 1;
-        files[selectedFile].setColumns(stringToListColumns(value.toString()));
+        file.setColumns(columns);
         drawLines();
         break;
+    }
     case NodeType::LineWidth:
         files[row(parent(node)) - 1].setLineWidth(value.toInt());
         drawLines();
@@ -248,6 +427,61 @@ bool ChartEditModel::setData(const QModelIndex& index, const QVariant& value, in
         files[row(parent(node)) - 1].setMultiplier(value.toDouble());
         drawLines();
         break;
+    case NodeType::Format:
+    {
+        bool ok;
+        DisplayFormat displayFormat = stringToDisplayFormat(value.toString(), &ok);
+        if (!ok)
+            return false;
+        files[row(parent(node)) - 1].setDisplayFormat(displayFormat);
+        drawLines();
+        break;
+    }
+    case NodeType::Aperture:
+        files[row(parent(node)) - 1].setAperture(value.toInt());
+        drawLines();
+        break;
+    case NodeType::Network:
+    {
+        bool ok;
+        NetworkType network = stringToNetworkType(value.toString(), &ok);
+        FileSNPData& file = files[row(parent(node)) - 1];
+        if (!ok || !file.supportsNetwork(network))
+        {
+            // the editor shows the network that is drawn again
+            emit dataChanged(index, index);
+            return false;
+        }
+        file.setNetwork(network);
+        drawLines();
+        break;
+    }
+    case NodeType::PortPairs:
+    {
+        // pairs are written like columns, [positive,negative] of every differential port
+        PortPairs portPairs = stringToListColumns(value.toString());
+        FileSNPData& file = files[row(parent(node)) - 1];
+        if (!portPairs.isEmpty() && !isValidPortPairing(portPairs, file.getDimension()))
+        {
+            emit dataChanged(index, index);
+            return false;
+        }
+        file.setPortPairs(portPairs);
+        drawLines();
+        break;
+    }
+    case NodeType::FrequencyRange:
+    {
+        bool ok;
+        FileSNPData::FrequencyRange frequencyRange = stringToFrequencyRange(value.toString(), &ok);
+        if (!ok || isVirtual(row(parent(node)) - 1))
+            return false;
+        const FileSNPData& file = files.at(row(parent(node)) - 1);
+        FileSNPData::FrequencyRange current = file.getFrequencyRange();
+        if (frequencyRange.minimum != current.minimum || frequencyRange.maximum != current.maximum)
+            startLoading(file.getFilePath(), frequencyRange);
+        break;
+    }
     }
     emit dataChanged(index, index);
     return true;
@@ -266,6 +500,10 @@ Qt::ItemFlags ChartEditModel::flags(const QModelIndex &index) const
     NodeType t = static_cast<Node*>(index.internalPointer())->type;
     if (!index.isValid())
         return 0;
+    // virtual files have no frequency range to load
+    Node* node = static_cast<Node*>(index.internalPointer());
+    if (t == NodeType::FrequencyRange && isVirtual(row(parent(node)) - 1))
+        return QAbstractItemModel::flags(index);
     if (t != NodeType::Configuration &&
         t != NodeType::FileName &&
         t != NodeType::FilePath &&
@@ -276,34 +514,307 @@ Qt::ItemFlags ChartEditModel::flags(const QModelIndex &index) const
 
 void ChartEditModel::addFile(QString filePath)
 {
-    int idx = -1;
-    for (int i = 0; i < files.size(); ++i)
+    int idx = findFile(filePath);
+    if (idx != -1)
     {
-        if (files.at(i).getFilePath() == filePath)
-            idx = i;
+        if (!files.at(idx).isLoading())
+        {
+            selectedFile = idx;
+            drawLines();
+        }
+        return;
     }
-    if (idx != -1)
+
+    // the file is shown in the tree right away,
+    // its fields are added when parsing is finished
+    files.push_back(FileSNPData::placeholder(filePath));
+
+    beginInsertRows(QModelIndex(), tree.size(), tree.size());
+    tree.push_back(new Node(this, NodeType::FileName));
+    endInsertRows();
+
+    startLoading(filePath, FileSNPData::FrequencyRange());
+}
+
+void ChartEditModel::startLoading(QString filePath, FileSNPData::FrequencyRange frequencyRange)
+{
+    // only the last requested range is loaded
+    auto previous = pendingLoads.find(filePath);
+    if (previous != pendingLoads.end())
     {
-        selectedFile = idx;
-        drawLines();
+        previous->control->cancelled = true;
+        disconnect(previous->watcher, nullptr, this, nullptr);
+        pendingLoads.erase(previous);
+    }
+
+    PendingLoad load;
+    load.control = std::make_shared<FileSNPData::LoadControl>();
+    load.watcher = new QFutureWatcher<LoadResult>(this);
+    connect(load.watcher, &QFutureWatcherBase::finished,
+            this, [this, filePath]() { finishLoading(filePath); });
+    connect(load.watcher, &QFutureWatcherBase::finished,
+            load.watcher, &QObject::deleteLater);
+    pendingLoads.insert(filePath, load);
+
+    std::shared_ptr<FileSNPData::LoadControl> control = load.control;
+    load.watcher->setFuture(QtConcurrent::run([filePath, control, frequencyRange]() {
+        LoadResult result;
+        try
+        {
+            result.data = std::make_shared<FileSNPData>(filePath, control.get(), frequencyRange);
+        }
+        catch (const std::exception& e)
+        {
+            result.error = e.what();
+        }
+        return result;
+    }));
+
+    if (!progressTimer->isActive())
+        progressTimer->start();
+}
+
+bool ChartEditModel::isLoading(int fileIndex) const
+{
+    return files.at(fileIndex).isLoading();
+}
+
+bool ChartEditModel::isVirtual(int fileIndex) const
+{
+    return virtualFiles.contains(files.at(fileIndex).getFilePath());
+}
+
+void ChartEditModel::addCascade(QList<int> fileIndices, QList<bool> inverted)
+{
+    // the name tells how the file is computed, e.g. "inv(fixture.s2p) * dut.s2p"
+    VirtualFile definition;
+    definition.operation = VirtualFile::Operation::Cascade;
+    QStringList factors;
+    for (int i = 0; i < fileIndices.size(); ++i)
+    {
+        const FileSNPData& file = files.at(fileIndices.at(i));
+        definition.inputs.push_back(file.getFilePath());
+        definition.inverted.push_back(inverted.at(i));
+        factors.push_back(inverted.at(i) ? "inv(" + file.getFileName() + ")" : file.getFileName());
+    }
+    addVirtualFile(factors.join(" * "), definition);
+}
+
+void ChartEditModel::addDifference(int fileIndex, int subtractedIndex)
+{
+    VirtualFile definition;
+    definition.operation = VirtualFile::Operation::Difference;
+    definition.inputs << files.at(fileIndex).getFilePath() << files.at(subtractedIndex).getFilePath();
+    addVirtualFile(files.at(fileIndex).getFileName() + " - " + files.at(subtractedIndex).getFileName(), definition);
+}
+
+void ChartEditModel::addVirtualFile(QString name, VirtualFile definition)
+{
+    // the same inputs and operation give the same file, it is only selected
+    // files that lost an input keep old data and are not reused
+    for (auto it = virtualFiles.cbegin(); it != virtualFiles.cend(); ++it)
+    {
+        if (!it->orphaned && it->operation == definition.operation && it->inputs == definition.inputs &&
+            it->inverted == definition.inverted)
+        {
+            selectedFile = findFile(it.key());
+            drawLines();
+            return;
+        }
+    }
+
+    // names only hold the file names of the inputs, other files may have the same one,
+    // e.g. with inputs of the same name from different directories
+    QString filePath = name;
+    for (int n = 2; findFile(filePath) != -1; ++n)
+        filePath = name + " (" + QString::number(n) + ")";
+
+    virtualFiles.insert(filePath, definition);
+    try
+    {
+        files.push_back(computeVirtualFile(filePath));
+    }
+    catch (const std::exception& e)
+    {
+        virtualFiles.remove(filePath);
+        emit fileLoadFailed(filePath, e.what());
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), tree.size(), tree.size());
+    tree.push_back(new Node(this, NodeType::FileName));
+    endInsertRows();
+    addFileNodes(files.size() - 1);
+
+    selectedFile = files.size() - 1;
+    drawLines();
+    emit fileLoaded(files.size() - 1);
+}
+
+FileSNPData ChartEditModel::computeVirtualFile(QString filePath) const
+{
+    const VirtualFile definition = virtualFiles.value(filePath);
+    QList<const FileSNPData*> inputs;
+    for (const QString& input : definition.inputs)
+    {
+        const int idx = findFile(input);
+        if (idx == -1)
+            throw std::runtime_error(input.toStdString() + " has been removed");
+        inputs.push_back(&files.at(idx));
+    }
+    if (definition.operation == VirtualFile::Operation::Difference)
+        return FileSNPData::difference(filePath, *inputs.at(0), *inputs.at(1), interpolation);
+    return FileSNPData::cascade(filePath, inputs, definition.inverted, interpolation);
+}
+
+void ChartEditModel::invalidateVirtualFiles(QString filePath)
+{
+    for (auto it = virtualFiles.begin(); it != virtualFiles.end(); ++it)
+    {
+        if (!it->outdated && it->inputs.contains(filePath))
+        {
+            it->outdated = true;
+            invalidateVirtualFiles(it.key());
+        }
+    }
+}
+
+void ChartEditModel::updateVirtualFile(QString filePath)
+{
+    auto definition = virtualFiles.find(filePath);
+    if (definition == virtualFiles.end() || !definition->outdated)
+        return;
+    // only files that are drawn are computed again, so inputs may be outdated as well
+    definition->outdated = false;
+    // files with a removed input keep their last data for good
+    if (definition->orphaned)
         return;
+    for (const QString& input : definition->inputs)
+        updateVirtualFile(input);
+
+    // a file whose inputs do not fit together anymore keeps its last data
+    const int fileIndex = findFile(filePath);
+    try
+    {
+        FileSNPData data = computeVirtualFile(filePath);
+        data.copyConfig(files.at(fileIndex));
+        files[fileIndex] = data;
+        clearLines(filePath);
     }
+    catch (const std::exception& e)
+    {
+        reportFailure(filePath, e.what());
+    }
+}
 
-    files.push_back(FileSNPData(filePath));
+void ChartEditModel::reportFailure(QString filePath, QString message)
+{
+    QMetaObject::invokeMethod(this, [this, filePath, message]() {
+        emit fileLoadFailed(filePath, message);
+    }, Qt::QueuedConnection);
+}
 
-    Node* fileNode = new Node(this, NodeType::FileName);
-    fileNode->children
+void ChartEditModel::configChanged(NodeType first, NodeType last)
+{
+    const Node* config = tree.first();
+    QModelIndex topLeft, bottomRight;
+    for (int i = 0; i < config->children.size(); ++i)
+    {
+        if (config->children.at(i)->type == first)
+            topLeft = createIndex(i, 0, config->children.at(i));
+        if (config->children.at(i)->type == last)
+            bottomRight = createIndex(i, 0, config->children.at(i));
+    }
+    emit dataChanged(topLeft, bottomRight);
+}
+
+void ChartEditModel::clearMarkers()
+{
+    markerLayer->clearMarkers();
+}
+
+void ChartEditModel::finishLoading(QString filePath)
+{
+    PendingLoad load = pendingLoads.take(filePath);
+    LoadResult result = load.watcher->result();
+    if (pendingLoads.isEmpty())
+        progressTimer->stop();
+
+    // removed files are disconnected from their watchers, so the file is still here
+    int fileIndex = findFile(filePath);
+    QModelIndex fileNode = index(fileIndex + 1, 0, QModelIndex());
+
+    // a file that was loaded before keeps its old data if reloading fails
+    const bool reloaded = !files.at(fileIndex).isLoading();
+    if (!result.data)
+    {
+        if (!reloaded)
+            removeFile(fileIndex);
+        else
+            emit dataChanged(fileNode, fileNode);
+        emit fileLoadFailed(filePath, result.error);
+        return;
+    }
+
+    if (reloaded)
+    {
+        result.data->copyConfig(files.at(fileIndex));
+        files[fileIndex] = *result.data;
+        // same file, new data
+        clearLines(filePath);
+        invalidateVirtualFiles(filePath);
+        drawLines();
+    }
+    else
+    {
+        files[fileIndex] = *result.data;
+        addFileNodes(fileIndex);
+        if (overlayFiles)
+            drawLines();
+    }
+    emit dataChanged(fileNode, fileNode);
+    emit fileLoaded(fileIndex);
+}
+
+void ChartEditModel::updateLoadingProgress()
+{
+    for (auto it = pendingLoads.cbegin(); it != pendingLoads.cend(); ++it)
+    {
+        QModelIndex fileIndex = index(findFile(it.key()) + 1, 0, QModelIndex());
+        emit dataChanged(fileIndex, fileIndex);
+    }
+}
+
+void ChartEditModel::addFileNodes(int fileIndex)
+{
+    Node* fileNode = tree.at(fileIndex + 1);
+    QVector<Node*> fields;
+    fields
         << new Node(this, NodeType::FilePath,     fileNode)
         << new Node(this, NodeType::Columns,      fileNode)
         << new Node(this, NodeType::LineWidth,    fileNode)
         << new Node(this, NodeType::LineColor,    fileNode)
         << new Node(this, NodeType::Multiplier,   fileNode)
-        << new Node(this, NodeType::Z0,           fileNode);
+        << new Node(this, NodeType::Format,       fileNode)
+        << new Node(this, NodeType::Aperture,     fileNode)
+        << new Node(this, NodeType::Network,      fileNode)
+        << new Node(this, NodeType::PortPairs,    fileNode)
+        << new Node(this, NodeType::Z0,           fileNode)
+        << new Node(this, NodeType::FrequencyRange, fileNode);
 
-    emit beginInsertRows(QModelIndex(), selectedFile + 1, selectedFile + 1);
-    tree.push_back(fileNode);
-    emit endInsertRows();
-    emit dataChanged(index(selectedFile + 1, 0, QModelIndex()), index(selectedFile + 1, 0, QModelIndex()));
+    beginInsertRows(index(fileIndex + 1, 0, QModelIndex()), 0, fields.size() - 1);
+    fileNode->children = fields;
+    endInsertRows();
+}
+
+int ChartEditModel::findFile(QString filePath) const
+{
+    for (int i = 0; i < files.size(); ++i)
+    {
+        if (files.at(i).getFilePath() == filePath)
+            return i;
+    }
+    return -1;
 }
 
 QList<FileInfo> ChartEditModel::fileInfoList() const
@@ -311,6 +822,9 @@ QList<FileInfo> ChartEditModel::fileInfoList() const
     QList<FileInfo> result;
     foreach (FileSNPData fileData, files)
     {
+        // virtual files cannot be loaded from a path
+        if (virtualFiles.contains(fileData.getFilePath()))
+            continue;
         result.push_back({
             fileData.getFilePath(),
             // TODO columns from files can be invalid
@@ -336,6 +850,25 @@ void ChartEditModel::removeFile(int fileIndex)
     if (fileIndex < 0 || fileIndex >= files.size())
         throw std::invalid_argument("No such file opened");
 
+    auto load = pendingLoads.find(files.at(fileIndex).getFilePath());
+    if (load != pendingLoads.end())
+    {
+        load->control->cancelled = true;
+        disconnect(load->watcher, nullptr, this, nullptr);
+        pendingLoads.erase(load);
+        if (pendingLoads.isEmpty())
+            progressTimer->stop();
+    }
+
+    // files computed from a removed file keep their last data
+    const QString filePath = files.at(fileIndex).getFilePath();
+    virtualFiles.remove(filePath);
+    for (VirtualFile& definition : virtualFiles)
+    {
+        if (definition.inputs.contains(filePath))
+            definition.orphaned = true;
+    }
+
     emit beginRemoveRows(QModelIndex(), fileIndex + 1, fileIndex + 1);
     delete tree.at(fileIndex + 1);
     tree.erase(tree.begin() + fileIndex + 1);
@@ -349,58 +882,330 @@ void ChartEditModel::removeFile(int fileIndex)
     drawLines();
 }
 
-void ChartEditModel::drawLines() const
+void ChartEditModel::drawLines()
 {
-    if (files.isEmpty() || selectedFile == -1)
+    // files on the chart: the selected one or all loaded files in overlay mode
+    QStringList shown;
+    for (int i = 0; i < files.size(); ++i)
     {
-        chart->removeAllSeries();
-        return;
+        if ((overlayFiles || i == selectedFile) && !files.at(i).isLoading())
+            shown.push_back(files.at(i).getFilePath());
+    }
+
+    for (const QString& filePath : shown)
+        updateVirtualFile(filePath);
+
+    // files that are not shown anymore take only their own series away
+    for (const QString& filePath : drawn.keys())
+    {
+        if (!shown.contains(filePath))
+            clearLines(filePath);
+    }
+
+    // stale series of all files are removed first and axes are fitted
+    // before new series are created, so no series is decimated twice
+    bool added = false;
+    for (const QString& filePath : shown)
+        added = pruneLines(files.at(findFile(filePath))) || added;
+
+    if (added && view != ChartView::Rectangular)
+    {
+        fitComplexAxes();
+    }
+    else if (added)
+    {
+        qreal xMin, xMax, yMin, yMax;
+        xMin = yMin = std::numeric_limits<qreal>::max();
+        xMax = yMax = std::numeric_limits<qreal>::lowest();
+        for (const QString& filePath : shown)
+        {
+            qreal fileXMin, fileXMax, fileYMin, fileYMax;
+            std::tie(fileXMin, fileXMax, fileYMin, fileYMax) =
+                files.at(findFile(filePath)).getDrawableBounds();
+            xMin = qMin(xMin, fileXMin);
+            xMax = qMax(xMax, fileXMax);
+            yMin = qMin(yMin, fileYMin);
+            yMax = qMax(yMax, fileYMax);
+        }
+        // files without columns give no bounds
+        if (xMin <= xMax && yMin <= yMax)
+        {
+            chart->axisX()->setRange(xMin, xMax);
+            chart->axisY()->setRange(yMin, yMax);
+        }
+    }
+
+    for (const QString& filePath : shown)
+        completeLines(files.at(findFile(filePath)));
+
+    updateRasterLayer();
+    markerLayer->refresh();
+
+    // numbers of files loaded on demand are only checked when they are decoded,
+    // inputs of virtual files may have been decoded without being shown
+    for (const FileSNPData& file : files)
+    {
+        const QString error = file.takeDecodeError();
+        if (!error.isEmpty())
+            reportFailure(file.getFilePath(), error);
+    }
+}
+
+bool ChartEditModel::pruneLines(const FileSNPData& file)
+{
+    // series of another type have nothing to reuse
+    auto found = drawn.find(file.getFilePath());
+    if (found != drawn.end() && found->smooth != smoothLines)
+    {
+        clearLines(file.getFilePath());
+        found = drawn.end();
+    }
+    if (found == drawn.end())
+    {
+        found = drawn.insert(file.getFilePath(), DrawnLines());
+        found->smooth = smoothLines;
+        found->multiplier = file.getMultiplier();
+        found->format = file.getDisplayFormat();
+        found->aperture = file.getAperture();
+        found->network = file.getNetwork();
+        found->portPairs = file.getPortPairs();
+        found->view = view;
+    }
+    DrawnLines& lines = *found;
+
+    // series of columns that are not selected anymore are removed,
+    // the others only get new points if the transform of the data changed
+    const bool transformChanged =
+        file.getMultiplier() != lines.multiplier || file.getDisplayFormat() != lines.format ||
+        (lines.format == DisplayFormat::GroupDelay && file.getAperture() != lines.aperture) ||
+        file.getNetwork() != lines.network ||
+        (lines.network == NetworkType::MixedModeS && file.getPortPairs() != lines.portPairs) ||
+        view != lines.view;
+    lines.multiplier = file.getMultiplier();
+    lines.format = file.getDisplayFormat();
+    lines.aperture = file.getAperture();
+    lines.network = file.getNetwork();
+    lines.portPairs = file.getPortPairs();
+    lines.view = view;
+    lines.outdated = lines.outdated || transformChanged;
+    const QList<std::pair<int, int>> columns = drawableColumns(file);
+    QList<DrawnSeries> kept;
+    for (const DrawnSeries& line : lines.series)
+    {
+        if (columns.contains(line.column))
+        {
+            kept.push_back(line);
+        }
+        else
+        {
+            chart->removeSeries(line.series);
+            delete line.series;
+        }
+    }
+    lines.series = kept;
+
+    // bounds of transformed data are different, so axes are fitted again
+    return kept.size() != columns.size() || transformChanged;
+}
+
+void ChartEditModel::completeLines(const FileSNPData& file)
+{
+    DrawnLines& lines = drawn[file.getFilePath()];
+    QMap<std::pair<int, int>, DrawnSeries> kept;
+    for (const DrawnSeries& line : lines.series)
+        kept.insert(line.column, line);
+    lines.series.clear();
+
+    for (const auto& column : drawableColumns(file))
+    {
+        if (kept.contains(column))
+        {
+            const DrawnSeries& line = kept.value(column);
+            if (lines.outdated)
+            {
+                line.series->replace(linePoints(file, column));
+                line.series->setName(file.getTraceName(column));
+            }
+            lines.series.push_back(line);
+            continue;
+        }
+        QXYSeries* curve = file.createSeries(column, linePoints(file, column), plotWidth(), smoothLines);
+        addSeries(curve);
+        lines.series.push_back({column, curve, curve->pen().color()});
+    }
+    lines.outdated = false;
+
+    // pens are restyled in place,
+    // color is set only for the last curve, the others keep the one of the theme
+    for (int i = 0; i < lines.series.size(); ++i)
+    {
+        const DrawnSeries& line = lines.series.at(i);
+        QPen pen = line.series->pen();
+        pen.setWidth(file.getLineWidth());
+        pen.setColor(i == lines.series.size() - 1 ? file.getLineColor() : line.themeColor);
+        if (pen != line.series->pen())
+            line.series->setPen(pen);
+    }
+}
+
+QList<std::pair<int, int>> ChartEditModel::drawableColumns(const FileSNPData& file) const
+{
+    // a column given twice is drawn once
+    QList<std::pair<int, int>> columns;
+    for (const auto& column : file.getColumns())
+    {
+        if (!columns.contains(column))
+            columns.push_back(column);
     }
+    return columns;
+}
 
+void ChartEditModel::clearLines()
+{
     chart->removeAllSeries();
+    drawn.clear();
+    updateRasterLayer();
+}
 
-    qreal xMin, xMax, yMin, yMax;
-    QList<QSplineSeries*> curves;
-    std::tie(xMin, xMax, yMin, yMax, curves) =
-        files.at(selectedFile).getDrawableData();
-
-    foreach (QSplineSeries* curve, curves)
-    {
-        chart->addSeries(curve);
-        connect(curve,
-                &QSplineSeries::hovered,
-                [this, curve](const QPointF& p, bool hovered) -> void
-                {
-                    if (!hovered)
-                    {
-                        coordinatesLabel->setVisible(false);
-                        return;
-                    }
-                    QPointF chartCoordinates = chart->mapToPosition(p, curve);
-                    coordinatesLabel->setPlainText(
-                        QString("[") + QString::number(p.x()) + "," + QString::number(p.y()) + "]"
-                    );
-                    chartCoordinates.setX(chartCoordinates.x() - coordinatesLabel->boundingRect().width() / 2);
-                    chartCoordinates.setY(chartCoordinates.y() - 20);
-                    coordinatesLabel->setPos(chartCoordinates);
-                    coordinatesLabel->setVisible(true);
-                    coordinatesLabel->setZValue(1);
-                }
-        );
-        curve->attachAxis(chart->axisX());
-        curve->attachAxis(chart->axisY());
-        auto pen = static_cast<QSplineSeries*>(chart->series().back())->pen();
-        pen.setWidth(files.at(selectedFile).getLineWidth());
-        static_cast<QSplineSeries*>(chart->series().back())->setPen(pen);
-    }
-
-    // set color only for the last curve
-    auto pen = static_cast<QSplineSeries*>(chart->series().back())->pen();
-    pen.setColor(files.at(selectedFile).getLineColor());
-    static_cast<QSplineSeries*>(chart->series().back())->setPen(pen);
-
-    chart->axisX()->setRange(xMin, xMax);
-    chart->axisY()->setRange(yMin, yMax);
+void ChartEditModel::clearLines(QString filePath)
+{
+    for (const DrawnSeries& line : drawn.value(filePath).series)
+    {
+        chart->removeSeries(line.series);
+        delete line.series;
+    }
+    drawn.remove(filePath);
+}
+
+void ChartEditModel::addSeries(QXYSeries* curve)
+{
+    chart->addSeries(curve);
+    curve->attachAxis(chart->axisX());
+    curve->attachAxis(chart->axisY());
+}
+
+void ChartEditModel::updateLevelOfDetail() const
+{
+    for (auto lines = drawn.cbegin(); lines != drawn.cend(); ++lines)
+    {
+        // a removed file may still be drawn until drawLines runs
+        const int fileIndex = findFile(lines.key());
+        if (fileIndex == -1)
+            continue;
+        const FileSNPData& file = files.at(fileIndex);
+        for (const DrawnSeries& line : lines->series)
+            line.series->replace(linePoints(file, line.column));
+    }
+    updateRasterLayer();
+}
+
+QVector<QPointF> ChartEditModel::linePoints(const FileSNPData& file, std::pair<int, int> column) const
+{
+    if (view != ChartView::Rectangular)
+        return file.getComplexPoints(column, plotWidth());
+
+    QValueAxis* axisX = static_cast<QValueAxis*>(chart->axisX());
+    return file.getDrawablePoints(column, axisX->min(), axisX->max(), plotWidth());
+}
+
+void ChartEditModel::fitComplexAxes()
+{
+    // the polar grid reaches the largest magnitude of drawn files,
+    // the Smith chart is the unit circle
+    qreal radius = 1;
+    if (view == ChartView::Polar)
+    {
+        radius = 0;
+        for (const QString& filePath : drawn.keys())
+        {
+            const int fileIndex = findFile(filePath);
+            if (fileIndex != -1)
+                radius = qMax(radius, files.at(fileIndex).getMaxMagnitude());
+        }
+    }
+    gridLayer->setView(view, radius);
+
+    const qreal half = COMPLEX_MARGIN * gridLayer->getOuterRadius();
+    const QRectF area = chart->plotArea();
+    const qreal aspect = area.height() > 0 ? area.width() / area.height() : 1;
+    chart->axisY()->setRange(-half, half);
+    chart->axisX()->setRange(-half * aspect, half * aspect);
+}
+
+void ChartEditModel::keepComplexAspect()
+{
+    if (view == ChartView::Rectangular)
+        return;
+
+    // the y range stays, x follows the width of the plot
+    QValueAxis* axisX = static_cast<QValueAxis*>(chart->axisX());
+    QValueAxis* axisY = static_cast<QValueAxis*>(chart->axisY());
+    const QRectF area = chart->plotArea();
+    if (area.height() <= 0)
+        return;
+    const qreal center = (axisX->min() + axisX->max()) / 2;
+    const qreal half = (axisY->max() - axisY->min()) / 2 * area.width() / area.height();
+    if (qAbs(axisX->max() - center - half) > half * 1e-9)
+        axisX->setRange(center - half, center + half);
+}
+
+void ChartEditModel::updateRasterLayer() const
+{
+    QList<RasterTraceLayer::Trace> traces;
+    for (const DrawnLines& lines : drawn)
+    {
+        for (const DrawnSeries& line : lines.series)
+        {
+            if (line.series->isVisible() == rasterRendering)
+                line.series->setVisible(!rasterRendering);
+            if (rasterRendering)
+                traces.push_back({line.series->pointsVector(), line.series->pen(), view == ChartView::Rectangular});
+        }
+    }
+
+    rasterLayer->setVisible(rasterRendering);
+    if (!rasterRendering)
+        return;
+
+    QValueAxis* axisX = static_cast<QValueAxis*>(chart->axisX());
+    QValueAxis* axisY = static_cast<QValueAxis*>(chart->axisY());
+    rasterLayer->render(
+        traces,
+        chart->plotArea(),
+        QRectF(QPointF(axisX->min(), axisY->min()), QPointF(axisX->max(), axisY->max()))
+    );
+}
+
+QVector<MarkerLayer::Readout> ChartEditModel::readTraces(qreal frequency) const
+{
+    QVector<MarkerLayer::Readout> result;
+    for (auto lines = drawn.cbegin(); lines != drawn.cend(); ++lines)
+    {
+        const int fileIndex = findFile(lines.key());
+        if (fileIndex == -1)
+            continue;
+        const FileSNPData& file = files.at(fileIndex);
+        for (const DrawnSeries& line : lines->series)
+        {
+            // markers sit on the traces: at the value along frequency, at the sample in the complex plane
+            const qreal value = file.getValueAt(line.column, frequency);
+            QPointF point(frequency, value);
+            if (view != ChartView::Rectangular)
+            {
+                const std::complex<qreal> sample = file.getComplexAt(line.column, frequency);
+                point = QPointF(sample.real(), sample.imag());
+            }
+            result.push_back({line.series->name(), line.series->pen().color(), value, point});
+        }
+    }
+    return result;
+}
+
+int ChartEditModel::plotWidth() const
+{
+    // the plot area is empty until the chart is laid out
+    const int width = qRound(chart->plotArea().width());
+    return width > 0 ? width : DEFAULT_PLOT_WIDTH;
 }
 
 QList<std::pair<int, int>> ChartEditModel::stringToListColumns(QString line) const
@@ -431,6 +1236,34 @@ QString ChartEditModel::listToStringColumns(QList<std::pair<int, int>> columns)
     return result;
 }
 
+FileSNPData::FrequencyRange ChartEditModel::stringToFrequencyRange(QString line, bool* ok) const
+{
+    FileSNPData::FrequencyRange result;
+    *ok = true;
+
+    QStringList bounds = line.split(QRegularExpression("\\s+"), QString::SkipEmptyParts);
+    if (bounds.isEmpty())
+        return result;
+
+    bool minimumOk = false, maximumOk = false;
+    if (bounds.size() == 2)
+    {
+        result.minimum = bounds.at(0).toDouble(&minimumOk);
+        result.maximum = bounds.at(1).toDouble(&maximumOk);
+    }
+    *ok = minimumOk && maximumOk && result.minimum <= result.maximum;
+    return result;
+}
+
+QString ChartEditModel::frequencyRangeToString(FileSNPData::FrequencyRange frequencyRange) const
+{
+    if (frequencyRange.isFull())
+        return QString();
+    // frequencies in Hz need more than the default 6 digits
+    return QString::number(frequencyRange.minimum, 'g', 12) + " " +
+           QString::number(frequencyRange.maximum, 'g', 12);
+}
+
 ChartEditModel::Node *ChartEditModel::parent(Node *child) const
 {
     return child ? child->parent : 0;
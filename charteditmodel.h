@@ -5,15 +5,21 @@
 #include <QAbstractItemModel>
 #include <QtCharts/QChart>
 #include <QList>
-#include <QtCharts/QSplineSeries>
+#include <QtCharts/QXYSeries>
 #include <QLabel>
-#include <QGraphicsTextItem>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QMap>
 
 #include <map>
+#include <memory>
 #include <utility>
 
 #include "chartconfiguration.h"
+#include "complexgridlayer.h"
 #include "filesnpdata.h"
+#include "markerlayer.h"
+#include "rastertracelayer.h"
 
 class ChartEditModel
     : public QAbstractItemModel
@@ -38,10 +44,23 @@ public:
     Qt::ItemFlags flags(const QModelIndex &index) const override;
 
 
+    // file is loaded in background, fileLoaded or fileLoadFailed is emitted when it is done
     void addFile(QString filePath);
     QList<FileInfo> fileInfoList() const;
     void setFiles(QList<FileInfo> fileInfoList);
+    // adds a file with the S-parameters of the files connected one after the other,
+    // inverted files are de-embedded; fileLoadFailed is emitted if they do not fit together
+    // The file is computed again before it is drawn once one of them has been reloaded.
+    void addCascade(QList<int> fileIndices, QList<bool> inverted);
+    // adds a file with the S-parameters of a file less the ones of another file,
+    // recomputed like a cascade
+    void addDifference(int fileIndex, int subtractedIndex);
+    // cancels loading if the file is not loaded yet
     void removeFile(int fileIndex);
+    bool isLoading(int fileIndex) const;
+    // computed from other files, there is nothing to load
+    bool isVirtual(int fileIndex) const;
+    void clearMarkers();
 
     enum class NodeType
     {
@@ -52,13 +71,23 @@ public:
         yMin, yMax,
         xGrid, yGrid,
         Legend,
+        SmoothLines,
+        OverlayFiles,
+        RasterRendering,
+        View,
+        Interpolation,
     FileName,
         FilePath,
         Columns,
         LineWidth,
         LineColor,
         Multiplier,
+        Format,
+        Aperture,
+        Network,
+        PortPairs,
         Z0,
+        FrequencyRange,
     Invalid
     };
 
@@ -83,13 +112,120 @@ public:
 
     static const std::map<NodeType, QString> TYPE_TO_STRING;
 
+signals:
+    // file fields have been added to the tree
+    void fileLoaded(int fileIndex);
+    void fileLoadFailed(QString filePath, QString message);
+
 private:
+    struct DrawnSeries
+    {
+        std::pair<int, int> column;
+        QtCharts::QXYSeries* series;
+        // color given by the chart theme when the series was added
+        QColor themeColor;
+    };
+
+    // what the chart shows for one file at the moment
+    struct DrawnLines
+    {
+        bool smooth = false;
+        qreal multiplier = 1;
+        DisplayFormat format = DisplayFormat::Real;
+        int aperture = 1;
+        NetworkType network = NetworkType::S;
+        PortPairs portPairs;
+        ChartView view = ChartView::Rectangular;
+        // points of the series do not match the transform yet
+        bool outdated = false;
+        QList<DrawnSeries> series;
+    };
 
-    void drawLines() const;
+    // file computed from loaded files
+    struct VirtualFile
+    {
+        enum class Operation { Cascade, Difference };
+        Operation operation = Operation::Cascade;
+        // paths of the files in order
+        QStringList inputs;
+        // only used by cascades
+        QList<bool> inverted;
+        // one of the inputs has been reloaded since the file was computed
+        bool outdated = false;
+        // one of the inputs has been removed, the file is not computed again
+        bool orphaned = false;
+    };
+
+    struct LoadResult
+    {
+        std::shared_ptr<FileSNPData> data;
+        QString error;
+    };
+
+    struct PendingLoad
+    {
+        std::shared_ptr<FileSNPData::LoadControl> control;
+        QFutureWatcher<LoadResult>* watcher;
+    };
+
+    // loads the file in background, the file entry has to exist already
+    void startLoading(QString filePath, FileSNPData::FrequencyRange frequencyRange);
+    void finishLoading(QString filePath);
+    void updateLoadingProgress();
+    void addFileNodes(int fileIndex);
+    int findFile(QString filePath) const;
+    // adds the virtual file named name, or a number is appended to the name if another file has it,
+    // selects the file instead if one with the same definition exists already
+    void addVirtualFile(QString name, VirtualFile definition);
+    // throws std::runtime_error if the inputs are gone or do not fit together anymore
+    FileSNPData computeVirtualFile(QString filePath) const;
+    // marks virtual files made of filePath as outdated, and the ones made of them
+    void invalidateVirtualFiles(QString filePath);
+    // computes filePath again if it is an outdated virtual file, its inputs first
+    // Failures are reported by reportFailure, as this runs while the chart is drawn.
+    void updateVirtualFile(QString filePath);
+    // emits fileLoadFailed once control is back in the event loop,
+    // so a message box never opens in the middle of drawing
+    void reportFailure(QString filePath, QString message);
+    // reports a change of the configuration fields from first to last
+    void configChanged(NodeType first, NodeType last);
+
+    // brings the chart up to date with the selected file or all files,
+    // series that did not change are kept as they are
+    void drawLines();
+    // removes series of file that do not match its columns anymore,
+    // returns true if some of its columns have no series now or the transform changed
+    bool pruneLines(const FileSNPData& file);
+    // adds missing series of file and restyles all of them
+    void completeLines(const FileSNPData& file);
+    QList<std::pair<int, int>> drawableColumns(const FileSNPData& file) const;
+    void clearLines();
+    void clearLines(QString filePath);
+    // adds a new series to the chart and its axes
+    void addSeries(QtCharts::QXYSeries* curve);
+    // replaces points of the drawn series with the ones seen in the current x range
+    void updateLevelOfDetail() const;
+    // points of column decimated for the current view and x range
+    QVector<QPointF> linePoints(const FileSNPData& file, std::pair<int, int> column) const;
+    // shows the whole grid of a polar or Smith chart with the same scale on both axes
+    void fitComplexAxes();
+    // keeps the scale of both axes of the complex plane the same when the plot is resized
+    void keepComplexAspect();
+    // hands the points of drawn series to the raster layer in raster mode
+    void updateRasterLayer() const;
+    // values of every drawn series at frequency for the marker layer
+    QVector<MarkerLayer::Readout> readTraces(qreal frequency) const;
+    // plot width in pixels, samples are decimated to it
+    int plotWidth() const;
+    static const int DEFAULT_PLOT_WIDTH = 1000;
 
     QList<std::pair<int, int>> stringToListColumns(QString line) const;
     QString listToStringColumns(QList<std::pair<int, int>> columns) const;
 
+    // "minimum maximum" in Hz, empty for the whole file
+    FileSNPData::FrequencyRange stringToFrequencyRange(QString line, bool* ok) const;
+    QString frequencyRangeToString(FileSNPData::FrequencyRange frequencyRange) const;
+
     Node *parent(Node *child) const;
     int row(Node *node) const;
 
@@ -97,11 +233,32 @@ private:
     QVector<Node*> tree;
 
     QtCharts::QChart* chart;
+    // spline series for sparse data, straight lines are drawn otherwise
+    bool smoothLines;
+    // selected columns of all loaded files are drawn, not only of the selected one
+    bool overlayFiles;
+    // series of every drawn file by its path
+    QMap<QString, DrawnLines> drawn;
+    // traces are rasterized on worker threads instead of drawn by the series
+    bool rasterRendering;
+    RasterTraceLayer* rasterLayer;
+    // frequency and value or the complex plane
+    ChartView view;
+    ComplexGridLayer* gridLayer;
 
     QList<FileSNPData> files;
     int selectedFile;
+    // how virtual files resample their inputs onto a common sweep
+    Interpolation interpolation;
+
+    // definitions of virtual files by their paths
+    QMap<QString, VirtualFile> virtualFiles;
+
+    // files that are being loaded by their paths
+    QMap<QString, PendingLoad> pendingLoads;
+    QTimer* progressTimer;
 
-    QGraphicsTextItem* coordinatesLabel;
+    MarkerLayer* markerLayer;
 };
 
 #endif // CHARTEDITMODEL_H
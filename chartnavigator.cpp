@@ -0,0 +1,144 @@
+#include "chartnavigator.h"
+
+#include <QMouseEvent>
+#include <QWheelEvent>
+#include <QtMath>
+
+QT_CHARTS_USE_NAMESPACE
+
+namespace
+{
+
+// a wheel notch zooms like QChart::zoomIn
+const qreal ZOOM_PER_NOTCH = 2;
+const int WHEEL_NOTCH = 120;
+// smaller rectangles are taken for clicks
+const int MIN_RUBBER_BAND = 4;
+
+} // namespace
+
+ChartNavigator::ChartNavigator(QChartView* view_)
+    : QObject(view_)
+    , view(view_)
+    , frameTimer(new QTimer(this))
+    , zoomFactor(1)
+    , drag(Drag::None)
+    , rubberBand(new QRubberBand(QRubberBand::Rectangle, view_->viewport()))
+{
+    frameTimer->setSingleShot(true);
+    frameTimer->setInterval(FRAME_INTERVAL);
+    connect(frameTimer, &QTimer::timeout, this, &ChartNavigator::applyFrame);
+
+    view->viewport()->installEventFilter(this);
+}
+
+bool ChartNavigator::eventFilter(QObject* watched, QEvent* e)
+{
+    Q_UNUSED(watched);
+
+    switch (e->type())
+    {
+    case QEvent::Wheel:
+    {
+        QWheelEvent* event = static_cast<QWheelEvent*>(e);
+        zoomFactor *= qPow(ZOOM_PER_NOTCH, static_cast<qreal>(event->angleDelta().y()) / WHEEL_NOTCH);
+        scheduleFrame();
+        event->accept();
+        return true;
+    }
+    case QEvent::MouseButtonPress:
+    {
+        QMouseEvent* event = static_cast<QMouseEvent*>(e);
+        if (drag != Drag::None || !view->chart()->plotArea().contains(toChart(event->pos())))
+            return false;
+        if (event->button() == Qt::MiddleButton)
+        {
+            drag = Drag::Pan;
+        }
+        else if (event->button() == Qt::LeftButton && (event->modifiers() & Qt::ControlModifier))
+        {
+            drag = Drag::Zoom;
+            rubberBand->setGeometry(QRect(event->pos(), QSize()));
+            rubberBand->show();
+        }
+        else
+        {
+            // plain clicks belong to the chart, e.g. to its markers
+            return false;
+        }
+        dragStart = dragLast = event->pos();
+        event->accept();
+        return true;
+    }
+    case QEvent::MouseMove:
+    {
+        QMouseEvent* event = static_cast<QMouseEvent*>(e);
+        if (drag == Drag::Pan)
+        {
+            scrollDelta += event->pos() - dragLast;
+            scheduleFrame();
+        }
+        else if (drag == Drag::Zoom)
+        {
+            rubberBand->setGeometry(QRect(dragStart, event->pos()).normalized());
+        }
+        else
+        {
+            return false;
+        }
+        dragLast = event->pos();
+        event->accept();
+        return true;
+    }
+    case QEvent::MouseButtonRelease:
+    {
+        QMouseEvent* event = static_cast<QMouseEvent*>(e);
+        if (drag == Drag::None)
+            return false;
+
+        if (drag == Drag::Zoom)
+        {
+            rubberBand->hide();
+            const QRect selected = QRect(dragStart, event->pos()).normalized();
+            if (selected.width() >= MIN_RUBBER_BAND && selected.height() >= MIN_RUBBER_BAND)
+            {
+                // pending wheel and pan steps come first, the rectangle was drawn over their result
+                applyFrame();
+                const QRectF rect = QRectF(toChart(selected.topLeft()), toChart(selected.bottomRight()))
+                    .intersected(view->chart()->plotArea());
+                view->chart()->zoomIn(rect);
+            }
+        }
+        drag = Drag::None;
+        event->accept();
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void ChartNavigator::scheduleFrame()
+{
+    if (!frameTimer->isActive())
+        frameTimer->start();
+}
+
+void ChartNavigator::applyFrame()
+{
+    frameTimer->stop();
+
+    // the chart scrolls the view, the content follows the mouse the other way
+    if (!scrollDelta.isNull())
+        view->chart()->scroll(-scrollDelta.x(), scrollDelta.y());
+    if (zoomFactor != 1)
+        view->chart()->zoom(zoomFactor);
+
+    zoomFactor = 1;
+    scrollDelta = QPointF();
+}
+
+QPointF ChartNavigator::toChart(QPoint position) const
+{
+    return view->chart()->mapFromScene(view->mapToScene(position));
+}
@@ -0,0 +1,58 @@
+#ifndef CHARTNAVIGATOR_H
+#define CHARTNAVIGATOR_H
+
+#include <QtCharts/QChartView>
+#include <QObject>
+#include <QPoint>
+#include <QPointF>
+#include <QRubberBand>
+#include <QTimer>
+
+// Zooming and panning of a chart view with the mouse:
+// the wheel zooms, dragging with the middle button pans
+// and dragging with Ctrl and the left button zooms into the selected rectangle.
+// Wheel and drag events only accumulate, the result is applied to the chart
+// once per frame, so a burst of events costs one update of the axes and series.
+class ChartNavigator
+    : public QObject
+{
+    Q_OBJECT
+
+// PRIVATE TYPES
+private:
+    enum class Drag { None, Pan, Zoom };
+
+// PRIVATE FIELDS
+private:
+    QtCharts::QChartView* view;
+    QTimer* frameTimer;
+
+    // accumulated since the last frame
+    qreal zoomFactor;
+    QPointF scrollDelta;
+
+    Drag drag;
+    QPoint dragStart;
+    QPoint dragLast;
+    QRubberBand* rubberBand;
+
+// PUBLIC METHODS
+public:
+    // filters events of the viewport of view
+    ChartNavigator(QtCharts::QChartView* view_);
+
+    static const int FRAME_INTERVAL = 16;
+
+// PROTECTED METHODS
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+// PRIVATE METHODS
+private:
+    void scheduleFrame();
+    void applyFrame();
+    // position in the viewport to coordinates of the chart
+    QPointF toChart(QPoint position) const;
+};
+
+#endif // CHARTNAVIGATOR_H
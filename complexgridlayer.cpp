@@ -0,0 +1,234 @@
+#include "complexgridlayer.h"
+
+#include <QFontMetricsF>
+#include <QPainter>
+#include <QValueAxis>
+#include <QtMath>
+
+#include <cmath>
+
+QT_CHARTS_USE_NAMESPACE
+
+namespace
+{
+
+const char* const VIEW_NAMES[] = {
+    "Rectangular", "Polar", "Smith"
+};
+
+// normalized resistances and reactances of the Smith chart lines
+const qreal SMITH_VALUES[] = {0.2, 0.5, 1, 2, 5};
+// a line of infinite length ends this close to the open circuit point
+const qreal LINE_END = M_PI / 2 - 1e-6;
+const int POLAR_RADIALS = 12;
+const int POLAR_RINGS = 5;
+
+// Γ = (z - 1) / (z + 1) of every normalized impedance r + jx, in place
+void impedancesToReflections(QVector<QPointF>& points)
+{
+    QPointF* p = points.data();
+    const int size = points.size();
+    for (int i = 0; i < size; ++i)
+    {
+        const qreal r = p[i].x();
+        const qreal x = p[i].y();
+        const qreal denominator = (r + 1) * (r + 1) + x * x;
+        p[i] = QPointF((r * r + x * x - 1) / denominator, 2 * x / denominator);
+    }
+}
+
+// points of a circle around the origin
+QVector<QPointF> circle(qreal radius)
+{
+    QVector<QPointF> result(ComplexGridLayer::LINE_POINTS);
+    for (int i = 0; i < result.size(); ++i)
+    {
+        const qreal angle = 2 * M_PI * i / (result.size() - 1);
+        result[i] = QPointF(radius * std::cos(angle), radius * std::sin(angle));
+    }
+    return result;
+}
+
+// 1, 2 or 5 times a power of ten, at least value
+qreal niceStep(qreal value)
+{
+    const qreal power = std::pow(qreal(10), std::floor(std::log10(value)));
+    for (qreal factor : {1, 2, 5})
+    {
+        if (factor * power >= value)
+            return factor * power;
+    }
+    return 10 * power;
+}
+
+} // namespace
+
+QStringList chartViewNames()
+{
+    QStringList result;
+    for (const char* name : VIEW_NAMES)
+        result.push_back(name);
+    return result;
+}
+
+QString chartViewToString(ChartView view)
+{
+    return VIEW_NAMES[static_cast<int>(view)];
+}
+
+ChartView stringToChartView(QString name, bool* ok)
+{
+    const int index = chartViewNames().indexOf(name);
+    if (ok)
+        *ok = index != -1;
+    return index == -1 ? ChartView::Rectangular : static_cast<ChartView>(index);
+}
+
+ComplexGridLayer::ComplexGridLayer(QChart* chart_)
+    : QGraphicsObject(chart_)
+    , chart(chart_)
+    , view(ChartView::Rectangular)
+    , radius(1)
+    , outerRadius(1)
+{
+}
+
+void ComplexGridLayer::setView(ChartView view_, qreal radius_)
+{
+    view = view_;
+    radius = radius_ > 0 ? radius_ : 1;
+    outerRadius = 1;
+
+    lines.clear();
+    labels.clear();
+    if (view == ChartView::Smith)
+        buildSmithGrid();
+    else if (view == ChartView::Polar)
+        buildPolarGrid();
+    refresh();
+}
+
+void ComplexGridLayer::refresh()
+{
+    prepareGeometryChange();
+    update();
+}
+
+QRectF ComplexGridLayer::boundingRect() const
+{
+    return chart->plotArea();
+}
+
+void ComplexGridLayer::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+
+    const QRectF area = chart->plotArea();
+    if (lines.isEmpty() || area.isEmpty())
+        return;
+
+    painter->save();
+    painter->setClipRect(area);
+    painter->setRenderHint(QPainter::Antialiasing);
+
+    const QPen minorPen(QColor(210, 210, 210), 0);
+    const QPen majorPen(QColor(120, 120, 120), 0);
+    for (const GridLine& line : lines)
+    {
+        painter->setPen(line.major ? majorPen : minorPen);
+        painter->drawPolyline(toPixels(line.points));
+    }
+
+    QVector<QPointF> positions;
+    for (const Label& label : labels)
+        positions.push_back(label.position);
+    const QPolygonF labelPixels = toPixels(positions);
+    const qreal descent = QFontMetricsF(painter->font()).descent();
+    painter->setPen(majorPen);
+    for (int i = 0; i < labels.size(); ++i)
+        painter->drawText(labelPixels.at(i) + QPointF(2, -descent), labels.at(i).text);
+
+    painter->restore();
+}
+
+void ComplexGridLayer::buildSmithGrid()
+{
+    // lines are built as impedances and mapped to reflection coefficients together
+    QVector<QPointF> impedances;
+    const auto addLine =
+    [&impedances](qreal r, qreal x, bool constantResistance)
+    {
+        // the free part runs over tan of evenly spaced angles, so points are dense near Γ = 1
+        for (int i = 0; i < LINE_POINTS; ++i)
+        {
+            const qreal angle = constantResistance ?
+                -LINE_END + 2 * LINE_END * i / (LINE_POINTS - 1) :
+                LINE_END * i / (LINE_POINTS - 1);
+            impedances.push_back(constantResistance ? QPointF(r, std::tan(angle)) : QPointF(std::tan(angle), x));
+        }
+    };
+
+    QList<bool> major;
+    // outer circle and the real axis
+    addLine(0, 0, true);
+    major.push_back(true);
+    addLine(0, 0, false);
+    major.push_back(true);
+    for (qreal value : SMITH_VALUES)
+    {
+        addLine(value, 0, true);
+        major.push_back(false);
+        addLine(0, value, false);
+        major.push_back(false);
+        addLine(0, -value, false);
+        major.push_back(false);
+
+        labels.push_back({QPointF((value - 1) / (value + 1), 0), QString::number(value)});
+    }
+
+    impedancesToReflections(impedances);
+    for (int i = 0; i < major.size(); ++i)
+        lines.push_back({impedances.mid(i * LINE_POINTS, LINE_POINTS), major.at(i)});
+}
+
+void ComplexGridLayer::buildPolarGrid()
+{
+    const qreal step = niceStep(radius / POLAR_RINGS);
+    const int rings = qMax(1, static_cast<int>(std::ceil(radius / step - 1e-9)));
+    const qreal outer = rings * step;
+    outerRadius = outer;
+
+    for (int ring = 1; ring <= rings; ++ring)
+    {
+        lines.push_back({circle(ring * step), ring == rings});
+        labels.push_back({QPointF(ring * step, 0), QString::number(ring * step)});
+    }
+    for (int radial = 0; radial < POLAR_RADIALS; ++radial)
+    {
+        const qreal angle = 2 * M_PI * radial / POLAR_RADIALS;
+        const QPointF end(outer * std::cos(angle), outer * std::sin(angle));
+        lines.push_back({{QPointF(0, 0), end}, radial % (POLAR_RADIALS / 2) == 0});
+        if (radial != 0)
+            labels.push_back({end, QString::number(360 * radial / POLAR_RADIALS) + "°"});
+    }
+}
+
+QPolygonF ComplexGridLayer::toPixels(const QVector<QPointF>& values) const
+{
+    const QRectF area = chart->plotArea();
+    const QValueAxis* axisX = static_cast<QValueAxis*>(chart->axisX());
+    const QValueAxis* axisY = static_cast<QValueAxis*>(chart->axisY());
+    const qreal xScale = area.width() / (axisX->max() - axisX->min());
+    const qreal yScale = area.height() / (axisY->max() - axisY->min());
+    const qreal xOffset = area.left() - axisX->min() * xScale;
+    const qreal yOffset = area.bottom() + axisY->min() * yScale;
+
+    QPolygonF result(values.size());
+    const QPointF* value = values.constData();
+    QPointF* pixel = result.data();
+    const int size = values.size();
+    for (int i = 0; i < size; ++i)
+        pixel[i] = QPointF(xOffset + value[i].x() * xScale, yOffset - value[i].y() * yScale);
+    return result;
+}
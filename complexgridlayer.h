@@ -0,0 +1,96 @@
+#ifndef COMPLEXGRIDLAYER_H
+#define COMPLEXGRIDLAYER_H
+
+#include <QtCharts/QChart>
+#include <QGraphicsObject>
+#include <QList>
+#include <QPointF>
+#include <QPolygonF>
+#include <QRectF>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// What the axes of the chart show: frequency and value of traces,
+// or the complex plane of samples with polar or Smith gridlines.
+enum class ChartView
+{
+    Rectangular,
+    Polar,
+    Smith
+};
+
+// names in the order of ChartView
+QStringList chartViewNames();
+QString chartViewToString(ChartView view);
+// ok is set to false for unknown names
+ChartView stringToChartView(QString name, bool* ok = nullptr);
+
+// Gridlines of the complex plane drawn over the plot area of a chart,
+// the axes of the chart give the real and imaginary range.
+// Lines are built once in values, constant resistance and reactance lines
+// of the Smith chart go through the impedance to reflection mapping as one batch,
+// and all points are mapped to pixels in one pass when the layer is painted.
+class ComplexGridLayer
+    : public QGraphicsObject
+{
+    Q_OBJECT
+
+// PRIVATE TYPES
+private:
+    struct GridLine
+    {
+        // in values of the axes
+        QVector<QPointF> points;
+        // outer circle and axes are stronger
+        bool major;
+    };
+
+    struct Label
+    {
+        QPointF position;
+        QString text;
+    };
+
+// PRIVATE FIELDS
+private:
+    QtCharts::QChart* chart;
+    ChartView view;
+    // magnitude the polar grid has to reach
+    qreal radius;
+    // radius of the outer circle of the grid
+    qreal outerRadius;
+    QList<GridLine> lines;
+    QList<Label> labels;
+
+// PUBLIC METHODS
+public:
+    ComplexGridLayer(QtCharts::QChart* chart_);
+
+    // nothing is drawn for Rectangular,
+    // radius is the magnitude the polar grid has to reach
+    void setView(ChartView view_, qreal radius_ = 1);
+
+    // redraws the layer after axes or the plot area have changed
+    void refresh();
+
+    qreal getOuterRadius() const
+    {
+        return outerRadius;
+    }
+
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+    // values of points on lines
+    static const int LINE_POINTS = 181;
+
+// PRIVATE METHODS
+private:
+    void buildSmithGrid();
+    void buildPolarGrid();
+    // all points of values to pixels of the plot area
+    QPolygonF toPixels(const QVector<QPointF>& values) const;
+};
+
+#endif // COMPLEXGRIDLAYER_H
@@ -0,0 +1,123 @@
+#include "decimation.h"
+
+#include <algorithm>
+
+MinMaxPyramid::MinMaxPyramid(const Sample* y_, int size_)
+    : y(y_)
+    , size(size_)
+{
+    // the first stored level is scanned from samples, every next one
+    // combines pairs of blocks of the previous level
+    for (int level = MIN_LEVEL; (size >> level) > 0; ++level)
+    {
+        const int blocks = size >> level;
+        std::vector<std::pair<qint32, qint32>> current(blocks);
+        for (int i = 0; i < blocks; ++i)
+        {
+            if (level == MIN_LEVEL)
+            {
+                current[i] = block(level, i);
+                continue;
+            }
+            const std::pair<int, int> left = levels.back()[2 * i];
+            const std::pair<int, int> right = levels.back()[2 * i + 1];
+            current[i].first = y[right.first] < y[left.first] ? right.first : left.first;
+            current[i].second = y[right.second] > y[left.second] ? right.second : left.second;
+        }
+        levels.push_back(std::move(current));
+    }
+}
+
+std::pair<int, int> MinMaxPyramid::find(int first, int last) const
+{
+    std::pair<int, int> result(first, first);
+    const auto take =
+    [this, &result](std::pair<int, int> extremes)
+    {
+        if (y[extremes.first] < y[result.first])
+            result.first = extremes.first;
+        if (y[extremes.second] > y[result.second])
+            result.second = extremes.second;
+    };
+
+    // bottom-up walk: blocks at the edges of the range are taken
+    // and the rest of the range moves one level up
+    for (int level = 0; first < last; ++level, first >>= 1, last >>= 1)
+    {
+        if (first & 1)
+            take(block(level, first++));
+        if (last & 1)
+            take(block(level, --last));
+    }
+    return result;
+}
+
+std::pair<int, int> MinMaxPyramid::block(int level, int i) const
+{
+    if (level >= MIN_LEVEL && level - MIN_LEVEL < static_cast<int>(levels.size()))
+        return levels[level - MIN_LEVEL][i];
+
+    const int first = i << level;
+    const int last = (i + 1) << level;
+    std::pair<int, int> result(first, first);
+    for (int j = first + 1; j < last; ++j)
+    {
+        if (y[j] < y[result.first])
+            result.first = j;
+        if (y[j] > y[result.second])
+            result.second = j;
+    }
+    return result;
+}
+
+QVector<QPointF> MinMaxPyramid::decimate(const qreal* x, qreal xMin, qreal xMax, int columns) const
+{
+    QVector<QPointF> result;
+
+    // visible samples and one neighbour on each side
+    const int visibleFirst = static_cast<int>(std::lower_bound(x, x + size, xMin) - x);
+    const int visibleLast = static_cast<int>(std::upper_bound(x, x + size, xMax) - x);
+    const int first = qMax(0, visibleFirst - 1);
+    const int last = qMin(size, visibleLast + 1);
+    if (first >= last)
+        return result;
+
+    columns = qMax(1, columns);
+    if (last - first <= 2 * columns || xMax <= xMin)
+    {
+        result.reserve(last - first);
+        for (int i = first; i < last; ++i)
+            result.push_back(QPointF(x[i], y[i]));
+        return result;
+    }
+
+    result.reserve(2 * columns + 2);
+    if (first < visibleFirst)
+        result.push_back(QPointF(x[first], y[first]));
+
+    // samples of a column are found by binary search, their extremes by the pyramid
+    const qreal columnWidth = (xMax - xMin) / columns;
+    int columnFirst = visibleFirst;
+    for (int column = 0; column < columns && columnFirst < visibleLast; ++column)
+    {
+        const int columnLast = column == columns - 1 ?
+            visibleLast :
+            static_cast<int>(std::lower_bound(x + columnFirst, x + visibleLast,
+                                              xMin + (column + 1) * columnWidth) - x);
+        if (columnLast == columnFirst)
+            continue;
+
+        const std::pair<int, int> extremes = find(columnFirst, columnLast);
+        const int earlier = qMin(extremes.first, extremes.second);
+        const int later = qMax(extremes.first, extremes.second);
+        result.push_back(QPointF(x[earlier], y[earlier]));
+        if (later != earlier)
+            result.push_back(QPointF(x[later], y[later]));
+        columnFirst = columnLast;
+    }
+
+    if (visibleLast < last)
+        result.push_back(QPointF(x[visibleLast], y[visibleLast]));
+
+    return result;
+}
@@ -0,0 +1,51 @@
+#ifndef DECIMATION_H
+#define DECIMATION_H
+
+#include <QPointF>
+#include <QVector>
+#include <QtGlobal>
+
+#include <utility>
+#include <vector>
+
+#include "sparameterdata.h"
+
+// Minimum and maximum of every 2^k samples of a trace, built once,
+// so that any range of samples is reduced in O(log n) and a whole plot
+// in time proportional to its width instead of the number of samples.
+// The trace is not copied and has to outlive the pyramid.
+class MinMaxPyramid
+{
+// PRIVATE FIELDS
+private:
+    const Sample* y;
+    int size;
+    // levels[k - MIN_LEVEL][i] are indices of the minimum and the maximum
+    // of samples [i * 2^k, (i + 1) * 2^k)
+    std::vector<std::vector<std::pair<qint32, qint32>>> levels;
+
+// PUBLIC METHODS
+public:
+    // smaller blocks are scanned, they are not worth the memory
+    static const int MIN_LEVEL = 4;
+
+    MinMaxPyramid(const Sample* y_, int size_);
+
+    // indices of the minimum and the maximum of samples [first, last), first < last
+    std::pair<int, int> find(int first, int last) const;
+
+    // Reduces the trace to what can be seen in `columns` pixel columns of [xMin, xMax].
+    // Every column keeps its minimum and maximum in the order they come,
+    // so peaks and notches narrower than a pixel are never lost.
+    // x has to be ascending. One sample on each side outside of the range is kept,
+    // so lines still reach the edges of the plot.
+    // Ranges that already fit into 2 * columns samples are returned as they are.
+    QVector<QPointF> decimate(const qreal* x, qreal xMin, qreal xMax, int columns) const;
+
+// PRIVATE METHODS
+private:
+    // indices of the minimum and the maximum of block i of level k
+    std::pair<int, int> block(int level, int i) const;
+};
+
+#endif // DECIMATION_H
@@ -0,0 +1,208 @@
+#include "displayformat.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+
+const char* const FORMAT_NAMES[] = {
+    "Real", "Imaginary", "Magnitude", "dB", "Phase", "Unwrapped Phase", "VSWR", "Group Delay"
+};
+
+// samples computed by one task
+const int BLOCK_SIZE = 1 << 16;
+
+// |S| = 0 has minus infinite dB and |S| = 1 infinite VSWR,
+// they are limited so that traces keep finite bounds
+const qreal MIN_POWER = 1e-30;
+const qreal MAX_VSWR = 1e6;
+const qreal MAX_REFLECTION = (MAX_VSWR - 1) / (MAX_VSWR + 1);
+
+// kernels work on [first, last) of the planes, math is done in qreal whatever samples are stored in
+
+void computeMagnitude(const Sample* __restrict re, const Sample* __restrict im,
+                      Sample* __restrict values, int first, int last)
+{
+    for (int i = first; i < last; ++i)
+        values[i] = static_cast<Sample>(std::sqrt(qreal(re[i]) * re[i] + qreal(im[i]) * im[i]));
+}
+
+void computeDB(const Sample* __restrict re, const Sample* __restrict im,
+               Sample* __restrict values, int first, int last)
+{
+    for (int i = first; i < last; ++i)
+    {
+        const qreal power = qreal(re[i]) * re[i] + qreal(im[i]) * im[i];
+        values[i] = static_cast<Sample>(10 * std::log10(qMax(power, MIN_POWER)));
+    }
+}
+
+template <typename T>
+void computePhase(const Sample* __restrict re, const Sample* __restrict im,
+                  T* __restrict values, int first, int last)
+{
+    for (int i = first; i < last; ++i)
+        values[i] = static_cast<T>(std::atan2(qreal(im[i]), qreal(re[i])) * (180 / M_PI));
+}
+
+void computeVSWR(const Sample* __restrict re, const Sample* __restrict im,
+                 Sample* __restrict values, int first, int last)
+{
+    for (int i = first; i < last; ++i)
+    {
+        const qreal reflection = qMin(std::sqrt(qreal(re[i]) * re[i] + qreal(im[i]) * im[i]), MAX_REFLECTION);
+        values[i] = static_cast<Sample>((1 + reflection) / (1 - reflection));
+    }
+}
+
+// start of every block of a sweep of size samples
+std::vector<int> splitBlocks(int size)
+{
+    std::vector<int> blocks;
+    for (int first = 0; first < size; first += BLOCK_SIZE)
+        blocks.push_back(first);
+    return blocks;
+}
+
+// phase in degrees made continuous, every step is taken for the shortest turn
+// Unwrapping is a prefix sum of whole turns: the turns of every step are counted
+// in a plain loop and summed inside of every block in parallel,
+// then only the totals of the blocks are summed in sequence.
+template <typename T>
+void unwrapPhase(T* values, int size)
+{
+    if (size < 2)
+        return;
+
+    const std::vector<int> blocks = splitBlocks(size);
+    std::vector<int> turns(size);
+    std::vector<int> blockTurns(blocks.size());
+    QtConcurrent::blockingMap(blocks, [&](int first) {
+        const int last = qMin(first + BLOCK_SIZE, size);
+        int* __restrict pturns = turns.data();
+        const T* __restrict pvalues = values;
+        for (int i = qMax(first, 1); i < last; ++i)
+            pturns[i] = -static_cast<int>(std::lround((qreal(pvalues[i]) - pvalues[i - 1]) / 360));
+        int sum = 0;
+        for (int i = first; i < last; ++i)
+        {
+            sum += pturns[i];
+            pturns[i] = sum;
+        }
+        blockTurns[first / BLOCK_SIZE] = sum;
+    });
+
+    std::vector<int> blockOffsets(blocks.size());
+    for (size_t block = 1; block < blocks.size(); ++block)
+        blockOffsets[block] = blockOffsets[block - 1] + blockTurns[block - 1];
+
+    QtConcurrent::blockingMap(blocks, [&](int first) {
+        const int last = qMin(first + BLOCK_SIZE, size);
+        const int offset = blockOffsets[first / BLOCK_SIZE];
+        const int* __restrict pturns = turns.data();
+        for (int i = first; i < last; ++i)
+            values[i] = static_cast<T>(values[i] + 360 * qreal(pturns[i] + offset));
+    });
+}
+
+// τ = -dφ/dω as a central difference over aperture points on each side,
+// the window is cut at the ends of the sweep
+void differentiatePhase(const qreal* __restrict phase, const qreal* __restrict frequencies, int size,
+                        int aperture, Sample* __restrict values, int first, int last)
+{
+    for (int i = first; i < last; ++i)
+    {
+        const int low = qMax(0, i - aperture);
+        const int high = qMin(size - 1, i + aperture);
+        const qreal span = frequencies[high] - frequencies[low];
+        values[i] = span > 0 ? static_cast<Sample>(-(phase[high] - phase[low]) / (360 * span)) : Sample(0);
+    }
+}
+
+} // namespace
+
+QStringList displayFormatNames()
+{
+    QStringList result;
+    for (const char* name : FORMAT_NAMES)
+        result.push_back(name);
+    return result;
+}
+
+QString displayFormatToString(DisplayFormat format)
+{
+    return FORMAT_NAMES[static_cast<int>(format)];
+}
+
+DisplayFormat stringToDisplayFormat(QString name, bool* ok)
+{
+    const int index = displayFormatNames().indexOf(name);
+    if (ok)
+        *ok = index != -1;
+    return index == -1 ? DisplayFormat::Real : static_cast<DisplayFormat>(index);
+}
+
+void computeDisplayFormat(DisplayFormat format, ParameterSpan parameter, Sample* values,
+                          const qreal* frequencies, int aperture)
+{
+    void (*kernel)(const Sample*, const Sample*, Sample*, int, int) = nullptr;
+    switch (format)
+    {
+    case DisplayFormat::Real:
+        std::copy(parameter.real, parameter.real + parameter.size, values);
+        return;
+    case DisplayFormat::Imaginary:
+        std::copy(parameter.imag, parameter.imag + parameter.size, values);
+        return;
+    case DisplayFormat::Magnitude:
+        kernel = computeMagnitude;
+        break;
+    case DisplayFormat::DB:
+        kernel = computeDB;
+        break;
+    case DisplayFormat::Phase:
+    case DisplayFormat::UnwrappedPhase:
+        kernel = computePhase<Sample>;
+        break;
+    case DisplayFormat::VSWR:
+        kernel = computeVSWR;
+        break;
+    case DisplayFormat::GroupDelay:
+        computeGroupDelay(parameter, frequencies, aperture, values);
+        return;
+    }
+
+    const std::vector<int> blocks = splitBlocks(parameter.size);
+    QtConcurrent::blockingMap(blocks, [&](int first) {
+        kernel(parameter.real, parameter.imag, values, first, qMin(first + BLOCK_SIZE, parameter.size));
+    });
+
+    if (format == DisplayFormat::UnwrappedPhase)
+        unwrapPhase(values, parameter.size);
+}
+
+void computeGroupDelay(ParameterSpan parameter, const qreal* frequencies, int aperture, Sample* values)
+{
+    const int size = parameter.size;
+    if (size == 0)
+        return;
+
+    // the unwrapped phase is kept in qreal, long lines turn by thousands of degrees
+    // and float samples would lose the small steps the delay comes from
+    std::vector<qreal> phase(size);
+    const std::vector<int> blocks = splitBlocks(size);
+    QtConcurrent::blockingMap(blocks, [&](int first) {
+        computePhase(parameter.real, parameter.imag, phase.data(), first, qMin(first + BLOCK_SIZE, size));
+    });
+    unwrapPhase(phase.data(), size);
+
+    aperture = qMax(1, aperture);
+    QtConcurrent::blockingMap(blocks, [&](int first) {
+        differentiatePhase(phase.data(), frequencies, size, aperture, values, first, qMin(first + BLOCK_SIZE, size));
+    });
+}
@@ -0,0 +1,43 @@
+#ifndef DISPLAYFORMAT_H
+#define DISPLAYFORMAT_H
+
+#include <QString>
+#include <QStringList>
+
+#include "sparameterdata.h"
+
+// Quantity a trace shows of its complex samples.
+enum class DisplayFormat
+{
+    Real,
+    Imaginary,
+    Magnitude,
+    DB,
+    // in degrees
+    Phase,
+    UnwrappedPhase,
+    VSWR,
+    // in seconds, from the phase and the frequencies of the sweep
+    GroupDelay
+};
+
+// names in the order of DisplayFormat
+QStringList displayFormatNames();
+QString displayFormatToString(DisplayFormat format);
+// ok is set to false for unknown names
+DisplayFormat stringToDisplayFormat(QString name, bool* ok = nullptr);
+
+// Computes format of every sample of parameter into values (parameter.size samples).
+// Kernels are plain loops over the separate real and imaginary planes, which the compiler
+// vectorizes, and blocks of samples are computed in parallel.
+// Real and Imaginary are plain copies, a caller can use the planes of the parameter instead.
+// frequencies (in Hz, ascending) and aperture are only used by GroupDelay.
+void computeDisplayFormat(DisplayFormat format, ParameterSpan parameter, Sample* values,
+                          const qreal* frequencies = nullptr, int aperture = 1);
+
+// Group delay -dφ/dω of every sample: the phase is unwrapped and differentiated
+// between the points aperture points before and after every point,
+// a wider aperture smooths out noise of the phase.
+void computeGroupDelay(ParameterSpan parameter, const qreal* frequencies, int aperture, Sample* values);
+
+#endif // DISPLAYFORMAT_H
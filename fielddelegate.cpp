@@ -5,6 +5,7 @@
 #include <QLineEdit>
 #include <QSpinBox>
 #include <QCheckBox>
+#include <QComboBox>
 #include <QRect>
 #include <QDoubleValidator>
 #include <QMessageBox>
@@ -12,12 +13,16 @@
 #include <QColorDialog>
 #include <QPainter>
 #include <QStyleOption>
+#include <QStringList>
 
 #include <stdexcept>
 #include <limits>
 
 #include "charteditmodel.h"
+#include "complexgridlayer.h"
+#include "displayformat.h"
 #include "filesnpdata.h"
+#include "resampling.h"
 
 class CorrectDoubleValidator
     : public QDoubleValidator
@@ -31,10 +36,12 @@ public:
     QValidator::State validate(QString &s, int &i) const override
     {
         Q_UNUSED(i);
+        // exponents are allowed, frequencies in Hz are big numbers
         for (auto& c : s)
         {
             if (c != '-' && c != '+' &&
-                c != '.' && !c.isDigit())
+                c != '.' && c != 'e' && c != 'E' &&
+                !c.isDigit())
                 return QValidator::Invalid;
         }
 
@@ -81,6 +88,45 @@ public:
     }
 };
 
+class FrequencyRangeValidator
+    : public QValidator
+{
+public:
+    FrequencyRangeValidator(QObject * parent = 0) :
+        QValidator(parent)
+    {
+    }
+
+    QValidator::State validate(QString &s, int &i) const override
+    {
+        Q_UNUSED(i);
+        for (auto& c : s)
+        {
+            if (c != '-' && c != '+' &&
+                c != '.' && c != 'e' && c != 'E' &&
+                c != ' ' && !c.isDigit())
+                return QValidator::Invalid;
+        }
+
+        // empty means the whole file
+        QStringList bounds = s.split(' ', QString::SkipEmptyParts);
+        bool ok = bounds.isEmpty();
+        if (bounds.size() == 2)
+        {
+            bool minimumOk, maximumOk;
+            double minimum = bounds.at(0).toDouble(&minimumOk);
+            double maximum = bounds.at(1).toDouble(&maximumOk);
+            ok = minimumOk && maximumOk && minimum <= maximum;
+        }
+
+        if (ok) {
+            return QValidator::Acceptable;
+        } else {
+            return QValidator::Intermediate;
+        }
+    }
+};
+
 class ColorEditor
     : public QWidget
 {
@@ -137,6 +183,7 @@ QWidget *FieldDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem
     QLineEdit* lineEdit;
     QSpinBox* spinBox;
     QCheckBox* checkBox;
+    QComboBox* comboBox;
 
     using NodeType = ChartEditModel::NodeType;
     switch (node->type) {
@@ -167,14 +214,50 @@ QWidget *FieldDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem
         spinBox->setSingleStep(1);
         spinBox->setFrame(false);
         return spinBox;
+    case NodeType::Aperture:
+        spinBox = new QSpinBox(parent);
+        spinBox->setRange(1, 1000);
+        spinBox->setSingleStep(1);
+        spinBox->setFrame(false);
+        return spinBox;
     case NodeType::Legend:
+    case NodeType::SmoothLines:
+    case NodeType::OverlayFiles:
+    case NodeType::RasterRendering:
         checkBox = new QCheckBox(parent);
         return checkBox;
     case NodeType::Columns:
+    case NodeType::PortPairs:
         lineEdit = new QLineEdit(parent);
         lineEdit->setValidator(new ColumnValidator);
         lineEdit->setFrame(false);
         return lineEdit;
+    case NodeType::FrequencyRange:
+        lineEdit = new QLineEdit(parent);
+        lineEdit->setValidator(new FrequencyRangeValidator);
+        lineEdit->setPlaceholderText("whole file");
+        lineEdit->setFrame(false);
+        return lineEdit;
+    case NodeType::Format:
+        comboBox = new QComboBox(parent);
+        comboBox->addItems(displayFormatNames());
+        comboBox->setFrame(false);
+        return comboBox;
+    case NodeType::View:
+        comboBox = new QComboBox(parent);
+        comboBox->addItems(chartViewNames());
+        comboBox->setFrame(false);
+        return comboBox;
+    case NodeType::Network:
+        comboBox = new QComboBox(parent);
+        comboBox->addItems(networkTypeNames());
+        comboBox->setFrame(false);
+        return comboBox;
+    case NodeType::Interpolation:
+        comboBox = new QComboBox(parent);
+        comboBox->addItems(interpolationNames());
+        comboBox->setFrame(false);
+        return comboBox;
     case NodeType::LineColor:
         return new ColorEditor(QColor(Qt::white), index, parent);
     }
@@ -192,6 +275,8 @@ void FieldDelegate::setEditorData(QWidget *editor, const QModelIndex &index) con
     case NodeType::xTitle:
     case NodeType::yTitle:
     case NodeType::Columns:
+    case NodeType::PortPairs:
+    case NodeType::FrequencyRange:
         static_cast<QLineEdit*>(editor)->setText(index.data(Qt::EditRole).toString());
         break;
     case NodeType::xMin:
@@ -204,11 +289,21 @@ void FieldDelegate::setEditorData(QWidget *editor, const QModelIndex &index) con
     case NodeType::xGrid:
     case NodeType::yGrid:
     case NodeType::LineWidth:
+    case NodeType::Aperture:
         static_cast<QSpinBox*>(editor)->setValue(index.data(Qt::EditRole).toInt());
         break;
     case NodeType::Legend:
+    case NodeType::SmoothLines:
+    case NodeType::OverlayFiles:
+    case NodeType::RasterRendering:
         static_cast<QCheckBox*>(editor)->setChecked(index.data(Qt::EditRole).toBool());
         break;
+    case NodeType::Format:
+    case NodeType::View:
+    case NodeType::Network:
+    case NodeType::Interpolation:
+        static_cast<QComboBox*>(editor)->setCurrentText(index.data(Qt::EditRole).toString());
+        break;
     case NodeType::LineColor:
         static_cast<ColorEditor*>(editor)->setColor(index.data(Qt::EditRole).value<QColor>());
         break;
@@ -225,6 +320,8 @@ void FieldDelegate::setModelData(QWidget *editor, QAbstractItemModel *model,
     case NodeType::xTitle:
     case NodeType::yTitle:
     case NodeType::Columns:
+    case NodeType::PortPairs:
+    case NodeType::FrequencyRange:
         model->setData(
             index,
             QVariant(static_cast<QLineEdit*>(editor)->text())
@@ -243,17 +340,30 @@ void FieldDelegate::setModelData(QWidget *editor, QAbstractItemModel *model,
     case NodeType::xGrid:
     case NodeType::yGrid:
     case NodeType::LineWidth:
+    case NodeType::Aperture:
         model->setData(
             index,
             QVariant(static_cast<QSpinBox*>(editor)->value())
         );
         break;
     case NodeType::Legend:
+    case NodeType::SmoothLines:
+    case NodeType::OverlayFiles:
+    case NodeType::RasterRendering:
         model->setData(
             index,
             QVariant(static_cast<QCheckBox*>(editor)->isChecked())
         );
         break;
+    case NodeType::Format:
+    case NodeType::View:
+    case NodeType::Network:
+    case NodeType::Interpolation:
+        model->setData(
+            index,
+            QVariant(static_cast<QComboBox*>(editor)->currentText())
+        );
+        break;
     case NodeType::LineColor:
         model->setData(
             index,
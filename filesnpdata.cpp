@@ -1,25 +1,307 @@
 #include "filesnpdata.h"
 
+#include <QtCharts/QLineSeries>
+#include <QtCharts/QSplineSeries>
 #include <QRegExp>
-#include <QTextStream>
 #include <QDir>
+#include <QThread>
+#include <QSettings>
+#include <QMutexLocker>
+#include <QtMath>
+#include <QtConcurrent/QtConcurrentMap>
 
+#include <algorithm>
+#include <iterator>
 #include <stdexcept>
 #include <limits>
+#include <memory>
+#include <numeric>
+#include <cmath>
+#include <string>
+#include <vector>
 
 #include "mainwindow.h"
+#include "snpcache.h"
+#include "snpparser.h"
 
 QT_CHARTS_USE_NAMESPACE
 
-FileSNPData::FileSNPData(QString filePath_)
-    : filePath(filePath_)
+namespace
+{
+
+// part of the data section parsed by one thread
+struct DataChunk
+{
+    SNPParser parser;
+    // index of the first number of the chunk in the whole data section
+    qint64 firstNumber;
+    qint64 numbers;
+    std::string error;
+};
+
+// small files are not worth the threading overhead
+const qint64 MIN_CHUNK_SIZE = 1 << 20;
+
+// records decoded by one task when a parameter is decoded on demand
+const int DECODE_RANGE_SIZE = 4096;
+
+// records between two entries of the sparse index of a file
+const int INDEX_INTERVAL = 1024;
+
+// points of files that are combined may differ by this part of the highest frequency
+// and still count as the same, e.g. when one file is given in MHz and the other one in GHz
+const qreal FREQUENCY_TOLERANCE = 1e-9;
+
+int chunkCount(qint64 dataSize)
+{
+    // a few chunks per thread even out the load
+    const qint64 byThreads = 4 * QThread::idealThreadCount();
+    const qint64 bySize = dataSize / MIN_CHUNK_SIZE;
+    return static_cast<int>(qMax<qint64>(1, qMin(byThreads, bySize)));
+}
+
+// error of a data section that does not hold the expected records:
+// numbers that end inside a record, records beyond the ones found by the sparse index of a band,
+// or records that disagree with [Number of Frequencies]
+std::runtime_error recordCountError(qint64 numbers, qint64 recordSize, bool ranged)
+{
+    if (numbers % recordSize != 0)
+        return std::runtime_error("Unexpected end of data: the last frequency record is incomplete.");
+    if (ranged)
+        return std::runtime_error("The file has changed since its records were indexed.");
+    return std::runtime_error("Number of frequency records does not match [Number of Frequencies].");
+}
+
+// record at which the data at frequency (in units of the file) starts:
+// the first one after it when after is set, otherwise the first one not below it.
+// Returns the record and its file offset, found by scanning forward
+// from the last index entry before the frequency.
+std::pair<int, qint64> findRecord(const SNPParser& data, const SNPCache::SparseIndex& index,
+                                  qreal frequency, bool after)
+{
+    const auto before =
+    [frequency, after](qreal value)
+    {
+        return after ? value <= frequency : value < frequency;
+    };
+
+    const int entry = static_cast<int>(
+        std::partition_point(index.frequencies.cbegin(), index.frequencies.cend(), before) -
+        index.frequencies.cbegin()
+    ) - 1;
+    if (entry < 0)
+        return {0, index.offsets.first()};
+
+    SNPParser parser = data;
+    parser.seek(index.offsets.at(entry));
+    for (int record = entry * index.interval; record < index.records; ++record)
+    {
+        if (!parser.findNumber())
+            break;
+        const qint64 offset = parser.offset();
+        qreal value;
+        parser.readNumber(value);
+        if (!before(value))
+            return {record, offset};
+
+        for (int i = 1; i < index.recordSize; ++i)
+        {
+            parser.findNumber();
+            parser.skipToken();
+        }
+    }
+    return {index.records, data.offset() + data.remaining()};
+}
+
+// splits records of the band [minimum, maximum] (in units of the file)
+// into chunks that start at index entries, returns the number of records
+int bandChunks(const char* begin, const SNPParser& data, const SNPCache::SparseIndex& index,
+               qreal minimum, qreal maximum, std::vector<DataChunk>& chunks)
+{
+    const std::pair<int, qint64> first = findRecord(data, index, minimum, false);
+    std::pair<int, qint64> last = findRecord(data, index, maximum, true);
+    if (last.first < first.first)
+        last = first;
+
+    // a few index intervals per chunk, as many chunks as a full parse would make
+    const int entries = last.first / index.interval - first.first / index.interval;
+    const int step = qMax(1, entries / chunkCount(last.second - first.second));
+
+    const auto addChunk =
+    [&](int record, qint64 from, qint64 to)
+    {
+        SNPParser parser(begin, begin + to);
+        parser.seek(from);
+        chunks.push_back({parser, qint64(record - first.first) * index.recordSize, 0, std::string()});
+    };
+
+    int record = first.first;
+    qint64 offset = first.second;
+    for (int entry = first.first / index.interval + step;
+         qint64(entry) * index.interval < last.first;
+         entry += step)
+    {
+        addChunk(record, offset, index.offsets.at(entry));
+        record = entry * index.interval;
+        offset = index.offsets.at(entry);
+    }
+    addChunk(record, offset, last.second);
+
+    return last.first - first.first;
+}
+
+} // namespace
+
+FileSNPData::FileSNPData()
+    : loading(true)
+    , dimension(0)
+    , networks(std::make_shared<QMap<NetworkKey, DerivedNetwork>>())
+    , traces(std::make_shared<QHash<TraceKey, std::shared_ptr<FormattedTrace>>>())
+{
+    setDefaultConfig();
+}
+
+FileSNPData::FileSNPData(QString filePath_, LoadControl* control, FrequencyRange frequencyRange_)
+    : loading(false)
+    , filePath(filePath_)
+    , frequencyRange(frequencyRange_)
+    , networks(std::make_shared<QMap<NetworkKey, DerivedNetwork>>())
+    , traces(std::make_shared<QHash<TraceKey, std::shared_ptr<FormattedTrace>>>())
 {
     QFile* pfile = openFile();
-    readData(pfile);
-    // pfile is deleted after readData
+
+    // big files are only indexed, their parameters are decoded when they are drawn
+    QSettings settings;
+    const qint64 onDemandThreshold =
+        settings.value("loading/onDemandThresholdMB", 256).toLongLong() * 1024 * 1024;
+
+    // files opened before are taken from the binary cache
+    SNPCache cache;
+    if (cache.read(*this))
+    {
+        delete pfile;
+    }
+    else
+    {
+        // pfile is deleted after readData
+        const bool complete = readData(pfile, control, onDemandThreshold);
+        normalizeFrequencies();
+        if (!recordIndex)
+            normalizeParameters();
+        // a band is not worth caching, the next band would miss anyway
+        if (complete && !recordIndex)
+            cache.write(*this);
+    }
+    restrictToRange();
     setDefaultConfig();
 }
 
+FileSNPData FileSNPData::placeholder(QString filePath_)
+{
+    FileSNPData file;
+    file.filePath = filePath_;
+    return file;
+}
+
+FileSNPData FileSNPData::cascade(QString name, const QList<const FileSNPData*>& files, const QList<bool>& inverted,
+                                 Interpolation interpolation)
+{
+    if (files.isEmpty())
+        throw std::runtime_error("Nothing to cascade");
+
+    const QVector<qreal> sweep = commonSweep(files);
+    const FileSNPData& first = *files.first();
+    const QVector<qreal> references = first.getReferenceImpedances();
+    for (const FileSNPData* file : files)
+    {
+        if (file->options.parameter != SNPOptions::Parameter::S)
+            throw std::runtime_error(file->getFileName().toStdString() + " has no S-parameters");
+        if (!isNetworkSupported(NetworkType::T, file->dimension))
+            throw std::runtime_error(file->getFileName().toStdString() + " has no even number of ports");
+        if (file->dimension != first.dimension)
+            throw std::runtime_error("Files have different numbers of ports");
+        if (file->getReferenceImpedances() != references)
+            throw std::runtime_error("Files have different reference impedances");
+    }
+
+    // files on the common sweep already keep their T-parameters
+    QList<CascadeFactor> factors;
+    for (int i = 0; i < files.size(); ++i)
+    {
+        const FileSNPData aligned = files.at(i)->resampled(sweep, interpolation);
+        factors.push_back({aligned.getDerivedNetwork(NetworkType::T).data, inverted.at(i)});
+    }
+
+    FileSNPData result = combined(name, first, sweep);
+    result.dataPoints = cascadeNetworks(factors);
+    return result;
+}
+
+FileSNPData FileSNPData::difference(QString name, const FileSNPData& minuend, const FileSNPData& subtrahend,
+                                    Interpolation interpolation)
+{
+    const QVector<qreal> sweep = commonSweep({&minuend, &subtrahend});
+    for (const FileSNPData* file : {&minuend, &subtrahend})
+    {
+        if (file->options.parameter != SNPOptions::Parameter::S)
+            throw std::runtime_error(file->getFileName().toStdString() + " has no S-parameters");
+    }
+    if (minuend.dimension != subtrahend.dimension)
+        throw std::runtime_error("Files have different numbers of ports");
+    if (minuend.getReferenceImpedances() != subtrahend.getReferenceImpedances())
+        throw std::runtime_error("Files have different reference impedances");
+
+    const FileSNPData first = minuend.resampled(sweep, interpolation);
+    const FileSNPData second = subtrahend.resampled(sweep, interpolation);
+    first.decodeParameters();
+    second.decodeParameters();
+
+    FileSNPData result = combined(name, minuend, sweep);
+    result.dataPoints = subtractNetworks(first.dataPoints, second.dataPoints);
+    return result;
+}
+
+bool FileSNPData::isValidColumns(const QList<std::pair<int, int>>& columns_) const
+{
+    for (const auto& column : columns_)
+    {
+        if (column.first < 1 || column.first > dimension || column.second < 1 || column.second > dimension)
+            return false;
+    }
+    return true;
+}
+
+void FileSNPData::copyConfig(const FileSNPData& other)
+{
+    // a reloaded file may have fewer ports than before
+    if (isValidColumns(other.columns))
+        columns = other.columns;
+    lineWidth = other.lineWidth;
+    lineColor = other.lineColor;
+    multiplier = other.multiplier;
+    displayFormat = other.displayFormat;
+    aperture = other.aperture;
+    if (other.portPairs.isEmpty() || isValidPortPairing(other.portPairs, dimension))
+        portPairs = other.portPairs;
+    network = supportsNetwork(other.network) ? other.network : NetworkType::S;
+}
+
+FileSNPData FileSNPData::resampled(const QVector<qreal>& frequencies_, Interpolation interpolation) const
+{
+    if (isSameSweep(frequencies, frequencies_, frequencyTolerance()))
+        return *this;
+
+    decodeParameters();
+    FileSNPData result = *this;
+    // derived networks and traces of the new samples are not the ones of this file
+    result.networks = std::make_shared<QMap<NetworkKey, DerivedNetwork>>();
+    result.traces = std::make_shared<QHash<TraceKey, std::shared_ptr<FormattedTrace>>>();
+    result.recordIndex.reset();
+    result.frequencies = frequencies_;
+    result.dataPoints = resample(dataPoints, planResampling(frequencies, frequencies_, interpolation));
+    return result;
+}
+
 QString FileSNPData::getFileName() const
 {
     return filePath.mid(filePath.lastIndexOf('/') + 1);
@@ -28,121 +310,803 @@ QString FileSNPData::getFileName() const
 QFile* FileSNPData::openFile() const
 {
     // RegExp for finding file format
-    QRegExp formatRegExp = QRegExp("\\.s\\d+p$");
+    QRegExp formatRegExp = QRegExp("\\.(s\\d+p|ts)$");
     if (!filePath.contains(formatRegExp))
-        throw std::domain_error("Incorrect file format. Please open files with format \".sNp\" only.");
+        throw std::domain_error("Incorrect file format. Please open files with format \".sNp\" or \".ts\" only.");
 
     QFile* pdataFile = new QFile(filePath);
-    if (!pdataFile->open(QIODevice::ReadOnly | QIODevice::Text | QIODevice::ExistingOnly))
+    // no text mode: the parser reads raw bytes and treats '\r' as a space
+    if (!pdataFile->open(QIODevice::ReadOnly | QIODevice::ExistingOnly))
         throw std::runtime_error(pdataFile->errorString().toStdString());
 
     return pdataFile;
 }
 
-void FileSNPData::readData(QFile* pfile)
+bool FileSNPData::readData(QFile* pfile, LoadControl* control, qint64 onDemandThreshold)
 {
-    QTextStream in(pfile);
+    // kept by the record index when parameters are decoded on demand
+    std::shared_ptr<QFile> file(pfile);
+
+    // the file is mapped into memory and parsed in place,
+    // reading it into a buffer is only a fallback
+    QByteArray buffer;
+    const char* data = nullptr;
+    qint64 size = file->size();
+    if (size > 0)
+        data = reinterpret_cast<const char*>(file->map(0, size));
+    if (!data)
+    {
+        buffer = file->readAll();
+        data = buffer.constData();
+        size = buffer.size();
+    }
+    SNPParser parser(data, data + size);
+
+    SNPHeader header = parser.readHeader();
+    fileDescription = header.description;
+    dataHeader = header.optionLine;
+    options = header.options;
+    references = header.references;
 
-    // find N in .sNp
+    // find N in .sNp, version 2 files give it explicitly
     QRegExp formatRegExp = QRegExp("\\.s(\\d+)p$");
     formatRegExp.indexIn(filePath);
-    dimension = formatRegExp.cap(1).toInt();
-
-    const auto isFirstCharEqual =
-    [](QTextStream& in, char c)
-    {
-        // device is used because QTextStream
-        // does not have any convenient way of reading
-        // chars without removing them from the stream
-        char firstChar;
-        in.device()->getChar(&firstChar);
-        in.device()->ungetChar(firstChar);
-        return firstChar == c;
+    dimension = header.ports > 0 ? header.ports : formatRegExp.cap(1).toInt();
+    if (dimension <= 0)
+        throw std::domain_error("Number of ports is unknown: [Number of Ports] is missing.");
+    if (!references.isEmpty() && references.size() != dimension)
+        throw std::domain_error("[Reference] does not match the number of ports.");
+
+    // every record is a frequency followed by complex values of the matrix,
+    // upper and lower matrices only have the values of one triangle
+    const bool symmetric = header.matrixFormat != SNPHeader::MatrixFormat::Full;
+    QList<std::pair<int, int>> recordOrder;
+    for (int row = 0; row < dimension; ++row)
+    {
+        const int first = header.matrixFormat == SNPHeader::MatrixFormat::Upper ? row : 0;
+        const int last = header.matrixFormat == SNPHeader::MatrixFormat::Lower ? row : dimension - 1;
+        for (int column = first; column <= last; ++column)
+            recordOrder.push_back({row, column});
+    }
+    if (dimension == 2 && !symmetric && header.twoPortOrder21_12)
+        std::swap(recordOrder[1], recordOrder[2]);
+    const qint64 recordSize = 1 + 2 * recordOrder.size();
+
+    // a band of a file that was scanned before is read starting from the
+    // nearest entries of its sparse index, chunks then start at known records
+    SNPCache cache;
+    SNPCache::SparseIndex sparseIndex;
+    const bool ranged = !frequencyRange.isFull() &&
+                        cache.readIndex(filePath, sparseIndex) &&
+                        sparseIndex.recordSize == recordSize &&
+                        sparseIndex.offsets.first() >= parser.offset() &&
+                        sparseIndex.offsets.last() < parser.offset() + parser.remaining();
+
+    // otherwise the data section is cut at line boundaries and every piece
+    // is handled by its own thread: first numbers are counted,
+    // then each piece knows where its first number goes and parses in place
+    std::vector<DataChunk> chunks;
+    int records = header.frequencies;
+    if (ranged)
+    {
+        records = bandChunks(data, parser, sparseIndex,
+                             frequencyRange.minimum / options.frequencyScale,
+                             frequencyRange.maximum / options.frequencyScale,
+                             chunks);
+    }
+    else
+    {
+        for (const SNPParser& piece : parser.split(chunkCount(parser.remaining())))
+            chunks.push_back({piece, 0, 0, std::string()});
+    }
+    qint64 dataSize = 0;
+    for (const DataChunk& chunk : chunks)
+        dataSize += chunk.parser.remaining();
+    const bool onDemand = onDemandThreshold > 0 && dataSize > onDemandThreshold;
+
+    // with [Number of Frequencies] a single chunk needs no counting pass
+    const bool countingNeeded = !ranged && (header.frequencies < 0 || chunks.size() > 1);
+
+    // counting and parsing are equal steps of progress
+    std::atomic<int> chunksDone{0};
+    const int progressSteps = (countingNeeded ? 2 : 1) * static_cast<int>(chunks.size());
+    const auto isCancelled =
+    [control]()
+    {
+        return control && control->cancelled.load(std::memory_order_relaxed);
+    };
+    const auto chunkDone =
+    [control, &chunksDone, progressSteps]()
+    {
+        const int done = ++chunksDone;
+        if (control)
+            control->progress = done * 100 / progressSteps;
     };
 
-    // read file description
-    forever
+    if (countingNeeded)
     {
-        if (isFirstCharEqual(in, '!'))
-            fileDescription.push_back(in.device()->readLine());
-        else
-            break;
+        QtConcurrent::blockingMap(chunks, [&](DataChunk& chunk) {
+            if (isCancelled())
+                return;
+            chunk.numbers = chunk.parser.countNumbers();
+            chunkDone();
+        });
+        if (isCancelled())
+            throw std::runtime_error("Loading cancelled.");
+
+        qint64 numbers = 0;
+        for (DataChunk& chunk : chunks)
+        {
+            chunk.firstNumber = numbers;
+            numbers += chunk.numbers;
+        }
+        if (numbers % recordSize != 0 || (header.frequencies >= 0 && numbers / recordSize != header.frequencies))
+            throw recordCountError(numbers, recordSize, false);
+        records = static_cast<int>(numbers / recordSize);
     }
 
-    // read data header
-    if (isFirstCharEqual(in, '#'))
-        dataHeader = in.device()->readLine();
+    // storage is allocated once and filled through raw pointers,
+    // the n-th number of a record after the frequency goes to the n-th output
+    frequencies.resize(records);
+    dataPoints = SParameterData(
+        dimension, records, symmetric,
+        onDemand ? SParameterData::Allocation::OnDemand : SParameterData::Allocation::Contiguous
+    );
+    std::vector<Sample*> outputs;
+    QVector<int> parameterFields(dataPoints.getParameterCount());
+    for (int i = 0; i < recordOrder.size(); ++i)
+    {
+        const int parameter = dataPoints.parameterIndex(recordOrder[i].first, recordOrder[i].second);
+        parameterFields[parameter] = 1 + 2 * i;
+        if (!onDemand)
+        {
+            outputs.push_back(dataPoints.real(parameter));
+            outputs.push_back(dataPoints.imag(parameter));
+        }
+    }
+    qreal* pfrequency = frequencies.data();
 
-    // parse z0 value from header
+    // on demand only frequencies are read, the other numbers are skipped
+    // and positions of records are remembered
+    std::shared_ptr<RecordIndex> index;
+    qint64* precordOffset = nullptr;
+    if (onDemand)
     {
-    QTextStream headerReader(&dataHeader);
-    QString s;
-    headerReader >> s >> s >> s >> s >> s >> z0;
+        index = std::make_shared<RecordIndex>();
+        index->file = file;
+        index->buffer = buffer;
+        index->begin = data;
+        index->end = data + size;
+        index->offsets.resize(records);
+        index->parameterFields = parameterFields;
+        precordOffset = index->offsets.data();
     }
 
-    // discard other comments
-    forever
+    // a full scan remembers every INDEX_INTERVAL-th record for later bands
+    QVector<qint64> indexOffsets;
+    if (!ranged)
+        indexOffsets.resize((records + INDEX_INTERVAL - 1) / INDEX_INTERVAL);
+    qint64* pindexOffset = ranged ? nullptr : indexOffsets.data();
+
+    QtConcurrent::blockingMap(chunks, [&](DataChunk& chunk) {
+        try
+        {
+            qint64 record = chunk.firstNumber / recordSize;
+            qint64 field = chunk.firstNumber % recordSize;
+            qint64 numbers = 0;
+            while (chunk.parser.findNumber())
+            {
+                if (field == 0)
+                {
+                    if (isCancelled())
+                        return;
+                    // storage may come from [Number of Frequencies] or the sparse index without counting
+                    if (record == records)
+                        throw recordCountError(0, recordSize, ranged);
+                    if (precordOffset)
+                        precordOffset[record] = chunk.parser.offset();
+                    if (pindexOffset && record % INDEX_INTERVAL == 0)
+                        pindexOffset[record / INDEX_INTERVAL] = chunk.parser.offset();
+                    chunk.parser.readNumber(pfrequency[record]);
+                }
+                else if (onDemand)
+                    chunk.parser.skipToken();
+                else
+                {
+                    qreal value;
+                    chunk.parser.readNumber(value);
+                    outputs[field - 1][record] = static_cast<Sample>(value);
+                }
+
+                if (++field == recordSize)
+                {
+                    field = 0;
+                    ++record;
+                }
+                ++numbers;
+            }
+            chunk.numbers = numbers;
+        }
+        catch (const std::exception& e)
+        {
+            // exceptions must not leave worker threads
+            chunk.error = e.what();
+        }
+        chunkDone();
+    });
+    if (isCancelled())
+        throw std::runtime_error("Loading cancelled.");
+
+    qint64 numbers = 0;
+    for (const DataChunk& chunk : chunks)
+    {
+        if (!chunk.error.empty())
+            throw std::runtime_error(chunk.error);
+        numbers += chunk.numbers;
+    }
+    if (numbers != records * recordSize)
+        throw recordCountError(numbers, recordSize, ranged);
+
+    recordIndex = index;
+
+    // bands can only be searched in ascending frequencies
+    if (!ranged && records > INDEX_INTERVAL &&
+        std::is_sorted(frequencies.cbegin(), frequencies.cend()))
     {
-        if (isFirstCharEqual(in, '!'))
-            in.device()->readLine();
+        sparseIndex.recordSize = static_cast<qint32>(recordSize);
+        sparseIndex.interval = INDEX_INTERVAL;
+        sparseIndex.records = records;
+        sparseIndex.offsets = indexOffsets;
+        sparseIndex.frequencies.clear();
+        for (int record = 0; record < records; record += INDEX_INTERVAL)
+            sparseIndex.frequencies.push_back(frequencies.at(record));
+        cache.writeIndex(filePath, sparseIndex);
+    }
+
+    return !ranged;
+}
+
+void FileSNPData::restrictToRange()
+{
+    if (frequencyRange.isFull())
+        return;
+
+    // nothing is decoded yet for files loaded on demand, only the offsets of the band are kept
+    const auto restrictIndex =
+    [this](QVector<qint64> offsets)
+    {
+        std::shared_ptr<RecordIndex> index = std::make_shared<RecordIndex>();
+        index->file = recordIndex->file;
+        index->buffer = recordIndex->buffer;
+        index->begin = recordIndex->begin;
+        index->end = recordIndex->end;
+        index->offsets = offsets;
+        index->parameterFields = recordIndex->parameterFields;
+        recordIndex = index;
+        dataPoints = SParameterData(dimension, offsets.size(), dataPoints.isSymmetric(),
+                                    SParameterData::Allocation::OnDemand);
+    };
+
+    // version 1 files do not have to list frequencies in ascending order,
+    // records of their band are found by a linear scan and keep the order of the file
+    if (!std::is_sorted(frequencies.cbegin(), frequencies.cend()))
+    {
+        std::vector<int> points;
+        for (int i = 0; i < frequencies.size(); ++i)
+        {
+            if (frequencies.at(i) >= frequencyRange.minimum && frequencies.at(i) <= frequencyRange.maximum)
+                points.push_back(i);
+        }
+        if (static_cast<int>(points.size()) == frequencies.size())
+            return;
+
+        QVector<qreal> bandFrequencies;
+        QVector<qint64> bandOffsets;
+        for (int point : points)
+        {
+            bandFrequencies.push_back(frequencies.at(point));
+            if (recordIndex)
+                bandOffsets.push_back(recordIndex->offsets.at(point));
+        }
+        frequencies = bandFrequencies;
+        if (recordIndex)
+            restrictIndex(bandOffsets);
         else
-            break;
+            dataPoints = dataPoints.select(points);
+        return;
     }
 
-    dataPoints.resize(dimension * dimension);
-    // read the data
-    // it is assumed that no comments are present after this point
-    forever
+    const int first = std::lower_bound(frequencies.cbegin(), frequencies.cend(), frequencyRange.minimum) -
+                      frequencies.cbegin();
+    const int last = std::upper_bound(frequencies.cbegin(), frequencies.cend(), frequencyRange.maximum) -
+                     frequencies.cbegin();
+    if (first == 0 && last == frequencies.size())
+        return;
+
+    const int count = qMax(0, last - first);
+    frequencies = frequencies.mid(first, count);
+    if (recordIndex)
+        restrictIndex(recordIndex->offsets.mid(first, count));
+    else
+        dataPoints = dataPoints.slice(first, count);
+}
+
+void FileSNPData::decodeParameter(int parameter) const
+{
+    QMutexLocker locker(&recordIndex->mutex);
+    if (dataPoints.hasParameter(parameter))
+        return;
+
+    dataPoints.allocateParameter(parameter);
+    Sample* re = dataPoints.real(parameter);
+    Sample* im = dataPoints.imag(parameter);
+    const int field = recordIndex->parameterFields.at(parameter);
+
+    // records are independent, so ranges of them are decoded in parallel
+    const int records = recordIndex->offsets.size();
+    std::vector<std::pair<int, int>> ranges;
+    for (int first = 0; first < records; first += DECODE_RANGE_SIZE)
+        ranges.push_back({first, qMin(records, first + DECODE_RANGE_SIZE)});
+
+    // first error of every range, reported for the first range that has one
+    std::vector<std::string> errors(ranges.size());
+    QtConcurrent::blockingMap(ranges, [&](const std::pair<int, int>& range) {
+        std::string& error = errors[range.first / DECODE_RANGE_SIZE];
+        SNPParser parser(recordIndex->begin, recordIndex->end);
+        for (int record = range.first; record < range.second; ++record)
+        {
+            try
+            {
+                parser.seek(recordIndex->offsets[record]);
+                for (int i = 0; i < field; ++i)
+                {
+                    parser.findNumber();
+                    parser.skipToken();
+                }
+                qreal real, imag;
+                if (!parser.readNumber(real) || !parser.readNumber(imag))
+                    throw std::runtime_error("Unexpected end of data.");
+                re[record] = static_cast<Sample>(real);
+                im[record] = static_cast<Sample>(imag);
+            }
+            catch (const std::exception& e)
+            {
+                // numbers were not checked while indexing
+                re[record] = im[record] = qQNaN();
+                if (error.empty())
+                    error = "Frequency record " + std::to_string(record + 1) + ": " + e.what();
+            }
+        }
+    });
+    for (const std::string& error : errors)
     {
-        qreal freq, real, imag;
-        in >> freq;
-        // checking end of file in while condition
-        // may not work if there are space symbols
-        // after the last meaningful line
-        if (in.atEnd())
-            break;
-        frequencies.push_back(freq);
-        for (int i = 0; i < dimension * dimension; ++i)
+        if (!error.empty())
         {
-            in >> real >> imag;
-            dataPoints[i].push_back({real, imag});
+            if (recordIndex->error.isEmpty())
+                recordIndex->error = QString::fromStdString(error);
+            break;
         }
     }
 
-    pfile->close();
-    delete pfile;
+    normalizeParameter(parameter);
+}
+
+QString FileSNPData::takeDecodeError() const
+{
+    if (!recordIndex)
+        return QString();
+    QMutexLocker locker(&recordIndex->mutex);
+    QString error = recordIndex->error;
+    recordIndex->error.clear();
+    return error;
+}
+
+ParameterSpan FileSNPData::getParameter(int row, int column) const
+{
+    const int parameter = dataPoints.parameterIndex(row, column);
+    // planes are allocated before they are decoded, so only the lock held while decoding
+    // tells a complete parameter from one another thread is still writing,
+    // e.g. S12 and S21 of a symmetric file drawn in parallel
+    if (recordIndex)
+        decodeParameter(parameter);
+    return dataPoints.parameter(parameter);
+}
+
+void FileSNPData::normalizeFrequencies()
+{
+    const qreal scale = options.frequencyScale;
+    if (scale == 1)
+        return;
+
+    qreal* pfrequency = frequencies.data();
+    const int size = frequencies.size();
+    for (int i = 0; i < size; ++i)
+        pfrequency[i] *= scale;
+}
+
+void FileSNPData::normalizeParameters()
+{
+    if (options.format == SNPOptions::Format::RI)
+        return;
+
+    // every parameter is a separate pair of planes,
+    // so parameters are converted in parallel with plain loops over arrays
+    std::vector<int> parameterIndices(dataPoints.getParameterCount());
+    std::iota(parameterIndices.begin(), parameterIndices.end(), 0);
+    QtConcurrent::blockingMap(parameterIndices, [this](int parameter) {
+        normalizeParameter(parameter);
+    });
+}
+
+void FileSNPData::normalizeParameter(int parameter) const
+{
+    if (options.format == SNPOptions::Format::RI)
+        return;
+
+    const int size = dataPoints.getPointCount();
+    Sample* __restrict re = dataPoints.real(parameter);
+    Sample* __restrict im = dataPoints.imag(parameter);
+
+    // magnitude is in the real plane, angle in degrees in the imaginary one,
+    // conversion is done in qreal whatever the samples are stored in
+    const bool decibels = options.format == SNPOptions::Format::DB;
+    for (int i = 0; i < size; ++i)
+    {
+        const qreal magnitude = decibels ? std::pow(qreal(10), qreal(re[i]) / 20) : qreal(re[i]);
+        const qreal angle = qreal(im[i]) * (M_PI / 180);
+        re[i] = static_cast<Sample>(magnitude * std::cos(angle));
+        im[i] = static_cast<Sample>(magnitude * std::sin(angle));
+    }
+}
+
+FileSNPData FileSNPData::combined(QString name, const FileSNPData& first, const QVector<qreal>& sweep)
+{
+    FileSNPData result;
+    result.loading = false;
+    result.filePath = name;
+    result.options.frequencyScale = 1;
+    result.options.format = SNPOptions::Format::RI;
+    result.options.z0 = first.getZ0();
+    result.references = first.references;
+    result.frequencies = sweep;
+    result.dimension = first.dimension;
+    return result;
+}
+
+QVector<qreal> FileSNPData::commonSweep(const QList<const FileSNPData*>& files)
+{
+    qreal minimum = -std::numeric_limits<qreal>::infinity();
+    qreal maximum = std::numeric_limits<qreal>::infinity();
+    for (const FileSNPData* file : files)
+    {
+        if (file->isLoading())
+            throw std::runtime_error(file->getFileName().toStdString() + " is not loaded yet");
+        if (file->frequencies.isEmpty())
+            throw std::runtime_error(file->getFileName().toStdString() + " has no data");
+        minimum = qMax(minimum, file->frequencies.first());
+        maximum = qMin(maximum, file->frequencies.last());
+    }
+
+    const FileSNPData& first = *files.first();
+    const qreal tolerance = first.frequencyTolerance();
+    QVector<qreal> sweep;
+    for (qreal frequency : first.frequencies)
+    {
+        if (frequency >= minimum - tolerance && frequency <= maximum + tolerance)
+            sweep.push_back(frequency);
+    }
+    if (sweep.isEmpty())
+        throw std::runtime_error("Files have no frequencies in common");
+    return sweep;
+}
+
+qreal FileSNPData::frequencyTolerance() const
+{
+    return frequencies.isEmpty() ? 0 :
+        FREQUENCY_TOLERANCE * qMax(qAbs(frequencies.first()), qAbs(frequencies.last()));
+}
+
+void FileSNPData::decodeParameters() const
+{
+    for (int row = 0; row < dimension; ++row)
+    {
+        for (int column = 0; column < dimension; ++column)
+            getParameter(row, column);
+    }
 }
 
 void FileSNPData::setDefaultConfig()
 {
     lineWidth = 1;
     multiplier = 1;
+    displayFormat = DisplayFormat::Real;
+    aperture = 1;
+    network = NetworkType::S;
+    portPairs.clear();
 }
 
-std::tuple<qreal, qreal, qreal, qreal, QList<QtCharts::QSplineSeries*>>
-FileSNPData::getDrawableData() const
+std::tuple<qreal, qreal, qreal, qreal> FileSNPData::getDrawableBounds() const
 {
-    QList<QSplineSeries*> result;
     qreal xMin, xMax, yMin, yMax;
     xMin = yMin = std::numeric_limits<qreal>::max();
-    xMax = yMax = std::numeric_limits<qreal>::min();
+    xMax = yMax = std::numeric_limits<qreal>::lowest();
 
+    // frequencies are ascending, extremes of a whole trace come from its pyramid
+    const int size = getDataSize();
+    if (size > 0)
+    {
+        prepareTraces();
+        for (const auto& column : columns)
+        {
+            const FormattedTrace& trace = getTrace(column, displayFormat);
+            std::pair<int, int> extremes = trace.pyramid->find(0, size);
+            const qreal low = multiplier * trace.values[extremes.first];
+            const qreal high = multiplier * trace.values[extremes.second];
+            xMin = frequencies.first();
+            xMax = frequencies.last();
+            yMin = qMin(yMin, qMin(low, high));
+            yMax = qMax(yMax, qMax(low, high));
+        }
+    }
+
+    return std::make_tuple(xMin, xMax, yMin, yMax);
+}
+
+bool FileSNPData::supportsNetwork(NetworkType type) const
+{
+    // conversions start from S-parameters, Y, Z, H and G data is only shown as given
+    if (type != NetworkType::S && options.parameter != SNPOptions::Parameter::S)
+        return false;
+    if (type == NetworkType::MixedModeS)
+        return isValidPortPairing(getPortPairs(), dimension);
+    return isNetworkSupported(type, dimension);
+}
+
+PortPairs FileSNPData::getPortPairs() const
+{
+    return portPairs.isEmpty() ? defaultPortPairs(dimension) : portPairs;
+}
+
+QString FileSNPData::getTraceName(std::pair<int, int> column) const
+{
+    // tells files apart in the legend when several files are drawn
+    QString name = getFileName() + " " + networkTypePrefix(network);
+    if (network == NetworkType::MixedModeS)
+    {
+        // SDD, SDC, SCD and SCC are numbered by pairs
+        const int modes = dimension / 2;
+        const int row = column.first - 1, col = column.second - 1;
+        name += QString(row < modes ? "D" : "C") + (col < modes ? "D" : "C") +
+                QString::number(row % modes + 1) + "," + QString::number(col % modes + 1);
+    }
+    else
+    {
+        name += QString::number(column.first) + "," + QString::number(column.second);
+    }
+    if (displayFormat != DisplayFormat::Real)
+        name += " " + displayFormatToString(displayFormat);
+    return name;
+}
+
+qreal FileSNPData::getMaxMagnitude() const
+{
+    qreal result = 0;
+    const int size = getDataSize();
     for (const auto& column : columns)
     {
-        QSplineSeries* pseries = new QSplineSeries;
-        int idx = (column.first - 1) * dimension + (column.second - 1);
-        for (int i = 0; i < getDataSize(); ++i)
+        if (size == 0)
+            break;
+        const FormattedTrace& trace = getTrace(column, DisplayFormat::Magnitude);
+        result = qMax<qreal>(result, trace.values[trace.pyramid->find(0, size).second]);
+    }
+    return result;
+}
+
+QXYSeries* FileSNPData::createSeries(std::pair<int, int> column, const QVector<QPointF>& points,
+                                     int pixels, bool smooth) const
+{
+    // points are handed over at once, so the series is updated only once
+    QXYSeries* pseries;
+    if (smooth && points.size() <= pixels / 2)
+        pseries = new QSplineSeries;
+    else
+        pseries = new QLineSeries;
+    pseries->replace(points);
+    pseries->setName(getTraceName(column));
+    return pseries;
+}
+
+QVector<QPointF> FileSNPData::getDrawablePoints(std::pair<int, int> column,
+                                                qreal xMin, qreal xMax, int pixels) const
+{
+    QVector<QPointF> points = getTrace(column, displayFormat).pyramid->decimate(frequencies.constData(), xMin, xMax, pixels);
+    if (multiplier != 1)
+    {
+        for (QPointF& point : points)
+            point.setY(point.y() * multiplier);
+    }
+    return points;
+}
+
+qreal FileSNPData::getValueAt(std::pair<int, int> column, qreal frequency) const
+{
+    const int size = getDataSize();
+    if (size == 0 || frequency < frequencies.first() || frequency > frequencies.last())
+        return std::numeric_limits<qreal>::quiet_NaN();
+
+    const Sample* values = getTrace(column, displayFormat).values;
+    const int next = findFrequency(frequency);
+    if (next == 0 || frequencies.at(next) == frequency)
+        return multiplier * values[next];
+
+    const int previous = next - 1;
+    const qreal step = frequencies.at(next) - frequencies.at(previous);
+    const qreal weight = step > 0 ? (frequency - frequencies.at(previous)) / step : 0;
+    const qreal value = values[previous] + weight * (values[next] - values[previous]);
+    return multiplier * value;
+}
+
+QVector<QPointF> FileSNPData::getComplexPoints(std::pair<int, int> column, int pixels) const
+{
+    QVector<QPointF> result;
+    const int size = getDataSize();
+    const FormattedTrace& re = getTrace(column, DisplayFormat::Real);
+    const FormattedTrace& im = getTrace(column, DisplayFormat::Imaginary);
+
+    const int blocks = qMax(1, pixels);
+    if (size <= 4 * blocks)
+    {
+        result.reserve(size);
+        for (int i = 0; i < size; ++i)
+            result.push_back(QPointF(re.values[i], im.values[i]));
+        return result;
+    }
+
+    // extremes are kept in the order they come, so the curve keeps its turns;
+    // the first and the last sample are kept as they are
+    result.reserve(4 * blocks + 2);
+    result.push_back(QPointF(re.values[0], im.values[0]));
+    for (int block = 0; block < blocks; ++block)
+    {
+        const int first = static_cast<int>(qint64(size) * block / blocks);
+        const int last = static_cast<int>(qint64(size) * (block + 1) / blocks);
+        const std::pair<int, int> reExtremes = re.pyramid->find(first, last);
+        const std::pair<int, int> imExtremes = im.pyramid->find(first, last);
+        int indices[] = {reExtremes.first, reExtremes.second, imExtremes.first, imExtremes.second};
+        std::sort(std::begin(indices), std::end(indices));
+        for (int i = 0; i < 4; ++i)
         {
-            // take only real part for now
-            // TODO use multiplier
-            pseries->append(QPointF(frequencies[i], dataPoints[idx][i].real()));
-            xMin = qMin(xMin, frequencies[i]);
-            xMax = qMax(xMax, frequencies[i]);
-            yMin = qMin(yMin, dataPoints[idx][i].real());
-            yMax = qMax(yMax, dataPoints[idx][i].real());
+            if (i == 0 || indices[i] != indices[i - 1])
+                result.push_back(QPointF(re.values[indices[i]], im.values[indices[i]]));
         }
-        result.push_back(pseries);
     }
+    result.push_back(QPointF(re.values[size - 1], im.values[size - 1]));
+    return result;
+}
+
+std::complex<qreal> FileSNPData::getComplexAt(std::pair<int, int> column, qreal frequency) const
+{
+    const qreal nan = std::numeric_limits<qreal>::quiet_NaN();
+    const int size = getDataSize();
+    if (size == 0 || frequency < frequencies.first() || frequency > frequencies.last())
+        return {nan, nan};
 
-    return std::make_tuple(xMin, xMax, yMin, yMax, result);
+    ParameterSpan points = getColumnParameter(column);
+    const int next = findFrequency(frequency);
+    if (next == 0 || frequencies.at(next) == frequency)
+        return points[next];
+
+    const int previous = next - 1;
+    const qreal step = frequencies.at(next) - frequencies.at(previous);
+    const qreal weight = step > 0 ? (frequency - frequencies.at(previous)) / step : 0;
+    return points[previous] + weight * (points[next] - points[previous]);
+}
+
+int FileSNPData::findFrequency(qreal frequency) const
+{
+    // frequencies are ascending
+    return static_cast<int>(
+        std::lower_bound(frequencies.cbegin(), frequencies.cend(), frequency) - frequencies.cbegin()
+    );
+}
+
+void FileSNPData::prepareTraces() const
+{
+    QList<std::pair<int, int>> missing;
+    for (const auto& column : columns)
+    {
+        if (!missing.contains(column) && !traces->contains(traceKey(column, displayFormat)))
+            missing.push_back(column);
+    }
+    if (missing.size() < 2)
+        return;
+
+    // parameters are decoded and derived networks computed here first,
+    // decoding on demand is serialized anyway and the workers then only read samples
+    for (const auto& column : missing)
+        getColumnParameter(column);
+
+    // kernels of one trace run in parallel over blocks of samples as well,
+    // the thread pool shares the cores among both levels
+    std::vector<int> indices(missing.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    std::vector<std::shared_ptr<FormattedTrace>> computed(missing.size());
+    QtConcurrent::blockingMap(indices, [&](int i) {
+        computed[i] = computeTrace(missing.at(i), displayFormat);
+    });
+    for (int i = 0; i < missing.size(); ++i)
+        traces->insert(traceKey(missing.at(i), displayFormat), computed.at(i));
+}
+
+ParameterSpan FileSNPData::getColumnParameter(std::pair<int, int> column) const
+{
+    if (network == NetworkType::S)
+        return getParameter(column.first - 1, column.second - 1);
+    return getDerivedNetwork(network).data.parameter(column.first - 1, column.second - 1);
+}
+
+const FileSNPData::DerivedNetwork& FileSNPData::getDerivedNetwork(NetworkType type) const
+{
+    // computed once per type and pairing, so switching between them only draws again
+    const PortPairs pairs = type == NetworkType::MixedModeS ? getPortPairs() : PortPairs();
+    const NetworkKey key(static_cast<int>(type), pairs);
+    auto found = networks->constFind(key);
+    if (found != networks->constEnd())
+        return *found;
+
+    // all parameters take part, files loaded on demand are decoded completely
+    decodeParameters();
+    const DerivedNetwork derived{
+        networks->size() + 1,
+        type == NetworkType::MixedModeS ?
+            toMixedMode(dataPoints, pairs) :
+            convertNetwork(dataPoints, type, getReferenceImpedances())
+    };
+    return *networks->insert(key, derived);
+}
+
+FileSNPData::TraceKey FileSNPData::traceKey(std::pair<int, int> column, DisplayFormat format) const
+{
+    QPair<int, int> parameter(0, dataPoints.parameterIndex(column.first - 1, column.second - 1));
+    if (network != NetworkType::S)
+    {
+        const DerivedNetwork& derived = getDerivedNetwork(network);
+        parameter = qMakePair(derived.id, derived.data.parameterIndex(column.first - 1, column.second - 1));
+    }
+    return TraceKey(parameter, qMakePair(static_cast<int>(format),
+                                         format == DisplayFormat::GroupDelay ? aperture : 0));
+}
+
+const FileSNPData::FormattedTrace& FileSNPData::getTrace(std::pair<int, int> column, DisplayFormat format) const
+{
+    // computed on the first draw of a parameter in a format, copies of the file share it,
+    // so switching formats back and forth only decimates again
+    const TraceKey key = traceKey(column, format);
+    auto trace = traces->find(key);
+    if (trace == traces->end())
+        trace = traces->insert(key, computeTrace(column, format));
+    return **trace;
+}
+
+std::shared_ptr<FileSNPData::FormattedTrace> FileSNPData::computeTrace(std::pair<int, int> column,
+                                                                      DisplayFormat format) const
+{
+    ParameterSpan points = getColumnParameter(column);
+    std::shared_ptr<FormattedTrace> formatted = std::make_shared<FormattedTrace>();
+    if (format == DisplayFormat::Real)
+    {
+        formatted->values = points.real;
+    }
+    else if (format == DisplayFormat::Imaginary)
+    {
+        formatted->values = points.imag;
+    }
+    else
+    {
+        formatted->storage = SParameterData::allocateAligned(points.size);
+        computeDisplayFormat(format, points, formatted->storage.get(), frequencies.constData(), aperture);
+        formatted->values = formatted->storage.get();
+    }
+    formatted->pyramid.reset(new MinMaxPyramid(formatted->values, points.size));
+    return formatted;
 }
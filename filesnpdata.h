@@ -1,39 +1,169 @@
 #ifndef FILESNPDATA_H
 #define FILESNPDATA_H
 
-#include <QtCharts/QSplineSeries>
+#include <QtCharts/QXYSeries>
 #include <QList>
 #include <QVector>
 #include <QString>
 #include <QColor>
 #include <QFile>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QPair>
 #include <QString>
 
+#include <atomic>
 #include <complex>
+#include <limits>
+#include <memory>
 #include <utility>
 #include <tuple>
 
+#include "decimation.h"
+#include "displayformat.h"
+#include "networkconversion.h"
+#include "resampling.h"
+#include "snpparser.h"
+#include "sparameterdata.h"
+
 class FileSNPData
 {
+    // reads and writes parsed data directly
+    friend class SNPCache;
+
+// PUBLIC TYPES
+public:
+    // shared with the thread that loads the file:
+    // the loader reports progress in percents and stops once cancelled is set
+    struct LoadControl
+    {
+        std::atomic<bool> cancelled{false};
+        std::atomic<int> progress{0};
+    };
+
+    // band of frequencies in Hz to load, bounds included
+    struct FrequencyRange
+    {
+        qreal minimum = 0;
+        qreal maximum = std::numeric_limits<qreal>::infinity();
+
+        bool isFull() const
+        {
+            return minimum <= 0 && maximum == std::numeric_limits<qreal>::infinity();
+        }
+    };
+
 // PRIVATE FIELDS
 private:
+    bool loading;
     QString filePath;
+    // only records of this band are kept
+    FrequencyRange frequencyRange;
     QStringList fileDescription;
     QString dataHeader;
-    qreal z0;
+    // data is converted to Hz and real/imaginary parts while loading,
+    // options keep what the file used
+    SNPOptions options;
+    // impedances of every port from [Reference], empty if options.z0 is used
+    QVector<qreal> references;
 
     QVector<qreal> frequencies;
-    QVector<QVector<std::complex<qreal>>> dataPoints;
+    // parameters of files loaded on demand are decoded on first use,
+    // the planes are shared by all copies
+    mutable SParameterData dataPoints;
     int dimension;
 
+    // positions of records in the mapped file, null unless loaded on demand
+    struct RecordIndex
+    {
+        // keep the data alive
+        std::shared_ptr<QFile> file;
+        QByteArray buffer;
+        const char* begin;
+        const char* end;
+        // offset of the first number of every record
+        QVector<qint64> offsets;
+        // position of the real part of every parameter in a record
+        QVector<int> parameterFields;
+        QMutex mutex;
+        // first malformed number found while decoding that has not been reported yet
+        QString error;
+    };
+    std::shared_ptr<RecordIndex> recordIndex;
+
+    // values of a parameter in a display format with their min/max pyramid
+    struct FormattedTrace
+    {
+        // null for Real and Imaginary, which are planes of the parameter
+        std::shared_ptr<Sample> storage;
+        const Sample* values;
+        std::unique_ptr<MinMaxPyramid> pyramid;
+    };
+    // network matrix derived from the single ended data
+    struct DerivedNetwork
+    {
+        // tells traces of its parameters apart from the ones of other networks, S is 0
+        int id;
+        SParameterData data;
+    };
+    // type and port pairs of a derived network
+    typedef QPair<int, PortPairs> NetworkKey;
+    // derived networks computed so far, shared by all copies
+    std::shared_ptr<QMap<NetworkKey, DerivedNetwork>> networks;
+
+    // network id and parameter index, format and the aperture of group delay (0 for other formats)
+    typedef QPair<QPair<int, int>, QPair<int, int>> TraceKey;
+    // traces of drawn parameters, shared by all copies
+    std::shared_ptr<QHash<TraceKey, std::shared_ptr<FormattedTrace>>> traces;
+
     QList<std::pair<int, int>> columns;
     int lineWidth;
     QColor lineColor;
     qreal multiplier;
+    DisplayFormat displayFormat;
+    // points on each side of a point its group delay is taken over
+    int aperture;
+    // matrix the columns address
+    NetworkType network;
+    // empty for the default pairs
+    PortPairs portPairs;
 
 // PUBLIC METHODS
 public:
-    FileSNPData(QString filePath_);
+    FileSNPData(QString filePath_, LoadControl* control = nullptr,
+                FrequencyRange frequencyRange_ = FrequencyRange());
+
+    // empty entry that stands for a file which is still being loaded
+    static FileSNPData placeholder(QString filePath_);
+
+    // Files combined by cascade and difference are resampled with interpolation onto the points
+    // of the first file in the band all of them cover. Both throw std::runtime_error if the files
+    // do not fit together.
+
+    // file named name with the S-parameters of files connected one after the other
+    // by their second half of the ports, inverted files are de-embedded
+    // Files need S-parameters, the same number of ports and reference impedances.
+    static FileSNPData cascade(QString name, const QList<const FileSNPData*>& files, const QList<bool>& inverted,
+                               Interpolation interpolation);
+    // file named name with the S-parameters of minuend less the ones of subtrahend,
+    // e.g. to compare two measurements of the same network
+    // Files need S-parameters, the same number of ports and reference impedances.
+    static FileSNPData difference(QString name, const FileSNPData& minuend, const FileSNPData& subtrahend,
+                                  Interpolation interpolation);
+
+    // copy with the samples at frequencies_ (ascending), the file itself if it has these points already
+    // The copy computes its derived networks and traces again.
+    FileSNPData resampled(const QVector<qreal>& frequencies_, Interpolation interpolation) const;
+
+    // takes over columns, line style and how traces are computed,
+    // e.g. when the data of a file is replaced
+    void copyConfig(const FileSNPData& other);
+
+    bool isLoading() const
+    {
+        return loading;
+    }
 
     QString getFilePath() const
     {
@@ -42,6 +172,11 @@ public:
 
     QString getFileName() const;
 
+    FrequencyRange getFrequencyRange() const
+    {
+        return frequencyRange;
+    }
+
     QStringList getFileDescription() const
     {
         return fileDescription;
@@ -57,15 +192,55 @@ public:
         return frequencies.size();
     }
 
+    const QVector<qreal>& getFrequencies() const
+    {
+        return frequencies;
+    }
+
+    // parameters of files loaded on demand may be missing here,
+    // getParameter decodes them
+    const SParameterData& getDataPoints() const
+    {
+        return dataPoints;
+    }
+
+    // number of ports
+    int getDimension() const
+    {
+        return dimension;
+    }
+
+    // samples of S(row + 1)(column + 1), 0-based
+    // malformed numbers of files loaded on demand become NaN, takeDecodeError tells about them
+    ParameterSpan getParameter(int row, int column) const;
+
+    // first malformed number found by decoding parameters on demand since the last call,
+    // empty if there is none
+    QString takeDecodeError() const;
+
     qreal getZ0() const
     {
-        return z0;
+        return options.z0;
+    }
+
+    const SNPOptions& getOptions() const
+    {
+        return options;
+    }
+
+    // impedance of every port
+    QVector<qreal> getReferenceImpedances() const
+    {
+        return references.isEmpty() ? QVector<qreal>(dimension, options.z0) : references;
     }
 
     QList<std::pair<int, int>> getColumns() const
     {
         return columns;
     }
+    // every column (1-based row and column) is inside of the matrix
+    bool isValidColumns(const QList<std::pair<int, int>>& columns_) const;
+    // columns have to be valid
     void setColumns(QList<std::pair<int, int>> columns_)
     {
         columns = std::move(columns_);
@@ -98,17 +273,132 @@ public:
         multiplier = multiplier_;
     }
 
-    std::tuple<qreal, qreal, qreal, qreal, QList<QtCharts::QSplineSeries*>>
-    getDrawableData() const;
+    DisplayFormat getDisplayFormat() const
+    {
+        return displayFormat;
+    }
+    void setDisplayFormat(DisplayFormat displayFormat_)
+    {
+        displayFormat = displayFormat_;
+    }
+
+    int getAperture() const
+    {
+        return aperture;
+    }
+    void setAperture(int aperture_)
+    {
+        aperture = aperture_;
+    }
+
+    NetworkType getNetwork() const
+    {
+        return network;
+    }
+    // network has to be supported
+    void setNetwork(NetworkType network_)
+    {
+        network = network_;
+    }
+    // networks other than S need S-parameter data,
+    // mixed-mode, T and ABCD networks need an even number of ports
+    bool supportsNetwork(NetworkType type) const;
+
+    // pairs of the mixed-mode network, the default ones unless set
+    PortPairs getPortPairs() const;
+    // pairs have to be valid for the dimension, empty pairs give the default ones
+    void setPortPairs(PortPairs portPairs_)
+    {
+        portPairs = std::move(portPairs_);
+    }
+
+    // computes the traces of the selected columns in the display format that are not cached yet,
+    // in parallel over the columns, so the first draw of many columns uses all cores
+    void prepareTraces() const;
+
+    // name of the series of column, with the display format unless it is Real
+    QString getTraceName(std::pair<int, int> column) const;
+
+    // xMin, xMax, yMin, yMax of the selected columns
+    std::tuple<qreal, qreal, qreal, qreal> getDrawableBounds() const;
+
+    // largest magnitude of the selected columns, 0 if there is no data
+    qreal getMaxMagnitude() const;
+
+    // series of column (1-based row and column of the matrix) with points
+    // from getDrawablePoints or getComplexPoints for a plot that is pixels wide
+    // smooth gives spline series, but only to sparse traces with two pixels per point:
+    // splines through dense or decimated points only overshoot
+    QtCharts::QXYSeries* createSeries(std::pair<int, int> column, const QVector<QPointF>& points,
+                                      int pixels, bool smooth) const;
+
+    // points of column in the display format that can be seen in [xMin, xMax]
+    // on a plot that is pixels wide, scaled by the multiplier
+    QVector<QPointF> getDrawablePoints(std::pair<int, int> column,
+                                       qreal xMin, qreal xMax, int pixels) const;
+
+    // value of column drawn at frequency, interpolated between the nearest points,
+    // NaN outside of the loaded frequencies
+    qreal getValueAt(std::pair<int, int> column, qreal frequency) const;
+
+    // column as a curve in the complex plane (real part, imaginary part) for polar
+    // and Smith charts, the display format and the multiplier do not apply
+    // The sweep is cut into pixels blocks of points, every block keeps the points
+    // with the extremes of both parts, found in the pyramids of the planes.
+    QVector<QPointF> getComplexPoints(std::pair<int, int> column, int pixels) const;
+    // sample of column at frequency, interpolated between the nearest points,
+    // NaN outside of the loaded frequencies
+    std::complex<qreal> getComplexAt(std::pair<int, int> column, qreal frequency) const;
 
 // PRIVATE METHODS
 private:
+    FileSNPData();
+
     QFile* openFile() const;
 
     // file is deleted after readData
-    void readData(QFile* pfile);
+    // throws std::runtime_error if loading is cancelled through control
+    // data sections above onDemandThreshold bytes only get their frequencies read
+    // and recordIndex built
+    // returns false if only frequencyRange was read using the sparse index of the file
+    bool readData(QFile* pfile, LoadControl* control, qint64 onDemandThreshold);
+
+    // drops records outside of frequencyRange
+    void restrictToRange();
+
+    // decodes parameter unless it is already, the check is made under the lock of the record index
+    void decodeParameter(int parameter) const;
+
+    // converts frequencies to Hz
+    void normalizeFrequencies();
+    // converts samples from MA or DB to RI
+    void normalizeParameters();
+    void normalizeParameter(int parameter) const;
 
     void setDefaultConfig();
+
+    // empty loaded file named name with the ports and references of first on sweep
+    static FileSNPData combined(QString name, const FileSNPData& first, const QVector<qreal>& sweep);
+    // points of the first file in the band all files cover
+    // throws std::runtime_error if they have none in common or one is not loaded yet
+    static QVector<qreal> commonSweep(const QList<const FileSNPData*>& files);
+    // points closer than this count as the same frequency
+    qreal frequencyTolerance() const;
+    // decodes all parameters of files loaded on demand
+    void decodeParameters() const;
+
+    // samples of column (1-based row and column) of the selected network,
+    // derived networks are computed on first use
+    ParameterSpan getColumnParameter(std::pair<int, int> column) const;
+    const DerivedNetwork& getDerivedNetwork(NetworkType type) const;
+
+    TraceKey traceKey(std::pair<int, int> column, DisplayFormat format) const;
+    // column (1-based row and column of the matrix) in format, computed on first use
+    const FormattedTrace& getTrace(std::pair<int, int> column, DisplayFormat format) const;
+    // values of column in format with their pyramid, touches no cache
+    std::shared_ptr<FormattedTrace> computeTrace(std::pair<int, int> column, DisplayFormat format) const;
+    // index of the first frequency that is not below frequency
+    int findFrequency(qreal frequency) const;
 };
 
 #endif // FILESNPDATA_H
@@ -3,6 +3,9 @@
 
 int main(int argc, char *argv[]) {
     QApplication a(argc, argv);
+    // used by QSettings and QStandardPaths
+    a.setOrganizationName("SnP-Chart-Viewer");
+    a.setApplicationName("Chart");
     MainWindow w;
     w.show();
 
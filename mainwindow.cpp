@@ -5,7 +5,11 @@
 #include <QtCharts/QSplineSeries>
 #include <QStandardItem>
 #include <QStandardItemModel>
+#include <QComboBox>
+#include <QDialog>
+#include <QDialogButtonBox>
 #include <QFileDialog>
+#include <QLabel>
 #include <QMessageBox>
 #include <QTextStream>
 #include <QPushButton>
@@ -13,6 +17,7 @@
 #include <QSizePolicy>
 #include <QLineEdit>
 #include <QValueAxis>
+#include <QVBoxLayout>
 #include <QMenu>
 #include <QPixmap>
 #include <QClipboard>
@@ -20,6 +25,7 @@
 #include <tuple>
 
 #include "charteditmodel.h"
+#include "chartnavigator.h"
 #include "fielddelegate.h"
 #include "chartconfiguration.h"
 
@@ -30,7 +36,7 @@ QT_CHARTS_USE_NAMESPACE
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , copyMenu(new QMenu(this))
-    , deleteFileMenu(new QMenu(this))
+    , fileMenu(new QMenu(this))
 {
     setupUi(this);
     setupChart();
@@ -41,11 +47,14 @@ MainWindow::MainWindow(QWidget *parent)
     connect(btnLoadConfig, &QPushButton::clicked, this, &MainWindow::loadConfig);
     connect(btnClear, &QPushButton::clicked, this, &MainWindow::clearAll);
 
-    copyMenu->addAction("Copy Chart");
-    connect(copyMenu, &QMenu::triggered, this, &MainWindow::copyChart);
+    connect(copyMenu->addAction("Copy Chart"), &QAction::triggered, this, &MainWindow::copyChart);
+    connect(copyMenu->addAction("Clear Markers"), &QAction::triggered,
+            static_cast<ChartEditModel*>(treeView->model()), &ChartEditModel::clearMarkers);
 
-    deleteFileMenu->addAction("Delete");
-    connect(deleteFileMenu, &QMenu::triggered, this, &MainWindow::removeFile);
+    connect(fileMenu->addAction("Delete"), &QAction::triggered, this, &MainWindow::removeFile);
+    connect(fileMenu->addAction("Cascade With..."), &QAction::triggered, this, &MainWindow::cascadeFile);
+    connect(fileMenu->addAction("De-embed..."), &QAction::triggered, this, &MainWindow::deembedFile);
+    connect(fileMenu->addAction("Subtract..."), &QAction::triggered, this, &MainWindow::subtractFile);
 }
 
 void MainWindow::setupChart()
@@ -54,11 +63,14 @@ void MainWindow::setupChart()
     chart->legend()->hide();
     chart->addSeries(new QSplineSeries);
     chart->createDefaultAxes();
+    // frequencies are in Hz, so the X axis needs exponents
+    static_cast<QValueAxis*>(chart->axisX())->setLabelFormat("%.4g");
 
     chartView->setChart(chart);
     chartView->setRenderHint(QPainter::Antialiasing);
     chartView->setObjectName("chartView");
     chartView->installEventFilter(this);
+    new ChartNavigator(chartView);
 }
 
 void MainWindow::setupConfigNode()
@@ -77,9 +89,13 @@ void MainWindow::setupConfigNode()
 
     treeView->setItemDelegate(new FieldDelegate(this));
 
-    QAbstractItemModel* configModel = new ChartEditModel(chartView->chart());
+    ChartEditModel* configModel = new ChartEditModel(chartView->chart());
     treeView->setModel(configModel);
 
+    connect(configModel, &ChartEditModel::fileLoaded, this, &MainWindow::fileLoaded);
+    connect(configModel, &ChartEditModel::fileLoadFailed, this, &MainWindow::fileLoadFailed);
+    connect(configModel, &ChartEditModel::dataChanged, this, &MainWindow::updateEditors);
+
     treeView->setObjectName("treeView");
     treeView->installEventFilter(this);
 
@@ -88,23 +104,25 @@ void MainWindow::setupConfigNode()
 
 void MainWindow::addFile()
 {
-    try
-    {
-        QString filePath = QFileDialog::getOpenFileName(this, "Open File");
-        static_cast<ChartEditModel*>(treeView->model())->addFile(filePath);
-        refreshEditors();
-        // expand last file's section
-        treeView->expand(treeView->model()->index(treeView->model()->rowCount() - 1, 0));
-        treeView->setCurrentIndex(treeView->model()->index(
-            // first argument (1) is Columns field row number
-            // third argument is the last file section index
-            1, 0, treeView->model()->index(treeView->model()->rowCount() - 1, 0)
-        ));
-    }
-    catch (const std::exception& e)
-    {
-        QMessageBox::critical(this, "File open failed", e.what(), QMessageBox::Ok);
-    }
+    QString filePath = QFileDialog::getOpenFileName(this, "Open File");
+    if (filePath.isEmpty())
+        return;
+    // errors are reported through fileLoadFailed
+    static_cast<ChartEditModel*>(treeView->model())->addFile(filePath);
+}
+
+void MainWindow::fileLoaded(int fileIndex)
+{
+    refreshEditors();
+    QModelIndex fileRoot = treeView->model()->index(fileIndex + 1, 0);
+    treeView->expand(fileRoot);
+    // first argument (1) is Columns field row number
+    treeView->setCurrentIndex(treeView->model()->index(1, 0, fileRoot));
+}
+
+void MainWindow::fileLoadFailed(QString filePath, QString message)
+{
+    QMessageBox::critical(this, "File open failed", filePath + ":\n" + message, QMessageBox::Ok);
 }
 
 void MainWindow::saveConfig()
@@ -195,21 +213,22 @@ void MainWindow::refreshEditors()
     }
 }
 
+void MainWindow::updateEditors(const QModelIndex& topLeft, const QModelIndex& bottomRight)
+{
+    for (int i = topLeft.row(); i <= bottomRight.row(); ++i)
+    {
+        QModelIndex index = topLeft.sibling(i, 0);
+        QWidget* editor = treeView->indexWidget(index);
+        // the field being edited keeps what is typed into it
+        if (editor && !editor->hasFocus())
+            treeView->itemDelegate()->setEditorData(editor, index);
+    }
+}
+
 bool MainWindow::eventFilter(QObject *watched, QEvent *e)
 {
     if (watched->objectName() == "chartView")
     {
-        if (e->type() == QEvent::Wheel)
-        {
-            QWheelEvent* event = static_cast<QWheelEvent*>(e);
-            if (event->delta() > 0)
-                chartView->chart()->zoomIn();
-            else
-                chartView->chart()->zoomOut();
-            refreshEditors();
-            event->accept();
-            return true;
-        }
         if (e->type() == QEvent::MouseButtonPress)
         {
             QMouseEvent* event = static_cast<QMouseEvent*>(e);
@@ -236,13 +255,18 @@ bool MainWindow::eventFilter(QObject *watched, QEvent *e)
             auto fileIndex = treeView->indexAt(event->pos());
             if (static_cast<ChartEditModel::Node*>(fileIndex.internalPointer())->type == ChartEditModel::NodeType::FileName)
             {
-                deleteFileMenu->setVisible(true);
-                deleteFileMenu->move(QCursor::pos());
-                fileToBeRemoved = fileIndex.row() - 1;
+                menuFile = fileIndex.row() - 1;
+                // removing a file that is still loading cancels it
+                bool loading = static_cast<ChartEditModel*>(treeView->model())->isLoading(menuFile);
+                fileMenu->actions().at(0)->setText(loading ? "Cancel Loading" : "Delete");
+                for (int i = 1; i < fileMenu->actions().size(); ++i)
+                    fileMenu->actions().at(i)->setEnabled(!loading);
+                fileMenu->setVisible(true);
+                fileMenu->move(QCursor::pos());
             }
             else
             {
-                deleteFileMenu->setVisible(false);
+                fileMenu->setVisible(false);
             }
 
             return true;
@@ -263,5 +287,107 @@ void MainWindow::copyChart() const
 
 void MainWindow::removeFile()
 {
-    static_cast<ChartEditModel*>(treeView->model())->removeFile(fileToBeRemoved);
+    static_cast<ChartEditModel*>(treeView->model())->removeFile(menuFile);
+}
+
+void MainWindow::cascadeFile()
+{
+    QList<int> indices;
+    const QStringList names = otherFiles(&indices);
+    if (names.isEmpty())
+        return;
+
+    const int picked = pickFile("Cascade", "File connected to the second half of the ports:", names, 0);
+    if (picked == -1)
+        return;
+    // errors are reported through fileLoadFailed
+    static_cast<ChartEditModel*>(treeView->model())->addCascade({menuFile, indices.at(picked)}, {false, false});
+}
+
+void MainWindow::deembedFile()
+{
+    QList<int> indices;
+    QStringList names = otherFiles(&indices);
+    if (names.isEmpty())
+        return;
+    names.push_front("(none)");
+    indices.push_front(-1);
+
+    // the measurement is fixture A * DUT * fixture B in cascade order: A faces the DUT with its second half
+    // of ports, B with its first half
+    const int first = pickFile("De-embed", "Fixture before the device (second half of its ports at the device):",
+                               names, 1);
+    if (first == -1)
+        return;
+    const int second = pickFile("De-embed", "Fixture after the device (first half of its ports at the device):",
+                                names, 0);
+    if (second == -1)
+        return;
+
+    QList<int> fileIndices;
+    QList<bool> inverted;
+    if (indices.at(first) != -1)
+    {
+        fileIndices.push_back(indices.at(first));
+        inverted.push_back(true);
+    }
+    fileIndices.push_back(menuFile);
+    inverted.push_back(false);
+    if (indices.at(second) != -1)
+    {
+        fileIndices.push_back(indices.at(second));
+        inverted.push_back(true);
+    }
+    if (fileIndices.size() == 1)
+        return;
+    static_cast<ChartEditModel*>(treeView->model())->addCascade(fileIndices, inverted);
+}
+
+void MainWindow::subtractFile()
+{
+    QList<int> indices;
+    const QStringList names = otherFiles(&indices);
+    if (names.isEmpty())
+        return;
+
+    const int picked = pickFile("Subtract", "File subtracted from this one:", names, 0);
+    if (picked == -1)
+        return;
+    static_cast<ChartEditModel*>(treeView->model())->addDifference(menuFile, indices.at(picked));
+}
+
+int MainWindow::pickFile(QString title, QString label, const QStringList& names, int current)
+{
+    // files are told apart by their position, several of them may have the same name
+    QDialog dialog(this);
+    dialog.setWindowTitle(title);
+    QComboBox* comboBox = new QComboBox(&dialog);
+    comboBox->addItems(names);
+    comboBox->setCurrentIndex(current);
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    layout->addWidget(new QLabel(label, &dialog));
+    layout->addWidget(comboBox);
+    layout->addWidget(buttons);
+
+    if (dialog.exec() != QDialog::Accepted)
+        return -1;
+    return comboBox->currentIndex();
+}
+
+QStringList MainWindow::otherFiles(QList<int>* indices) const
+{
+    ChartEditModel* model = static_cast<ChartEditModel*>(treeView->model());
+    QStringList names;
+    for (int i = 0; i < model->rowCount(QModelIndex()) - 1; ++i)
+    {
+        if (i == menuFile || model->isLoading(i))
+            continue;
+        names.push_back(model->index(i + 1, 0, QModelIndex()).data().toString());
+        indices->push_back(i);
+    }
+    return names;
 }
@@ -33,18 +33,36 @@ private:
     void clearAll();
 
     void refreshEditors();
+    // loads changed values into open editors,
+    // the view does not do it for persistent editors
+    void updateEditors(const QModelIndex& topLeft, const QModelIndex& bottomRight);
 
     bool eventFilter(QObject* watched, QEvent* event);
 
     void copyChart() const;
     QMenu* copyMenu;
-    QMenu* deleteFileMenu;
-    int fileToBeRemoved;
+    QMenu* fileMenu;
+    // file the context menu was opened on
+    int menuFile;
 
     void removeFile();
+    // adds the cascade of the menu file with a file picked by the user
+    void cascadeFile();
+    // adds the menu file with fixtures picked by the user de-embedded
+    void deembedFile();
+    // adds the difference of the menu file and a file picked by the user
+    void subtractFile();
+    // names of loaded files other than the menu file, with their indices
+    QStringList otherFiles(QList<int>* indices) const;
+    // position of the name the user picks, -1 if the dialog is cancelled
+    int pickFile(QString title, QString label, const QStringList& names, int current);
+
+    // expands the section of a file that has just been loaded
+    void fileLoaded(int fileIndex);
+    void fileLoadFailed(QString filePath, QString message);
 
 public slots:
-    // opens file selection window and reads the file
+    // opens file selection window and starts loading the file
     // called when clicking on "AddFile" button
     void addFile();
 };
@@ -0,0 +1,330 @@
+#include "markerlayer.h"
+
+#include <QFontMetricsF>
+#include <QGraphicsSceneHoverEvent>
+#include <QGraphicsSceneMouseEvent>
+#include <QPainter>
+#include <QStringList>
+#include <QValueAxis>
+
+#include <cmath>
+
+QT_CHARTS_USE_NAMESPACE
+
+namespace
+{
+
+const qreal TABLE_MARGIN = 4;
+const qreal TABLE_PADDING = 4;
+const qreal COLUMN_GAP = 8;
+const qreal DOT_RADIUS = 3;
+
+QString frequencyToString(qreal frequency)
+{
+    return QString::number(frequency, 'g', 8) + " Hz";
+}
+
+QString valueToString(qreal value)
+{
+    return std::isnan(value) ? QString("-") : QString::number(value, 'g', 6);
+}
+
+} // namespace
+
+MarkerLayer::MarkerLayer(QChart* chart_)
+    : QGraphicsObject(chart_)
+    , chart(chart_)
+    , frequencyAxis(true)
+    , hovering(false)
+    , cursorFrequency(0)
+{
+    setAcceptHoverEvents(true);
+}
+
+void MarkerLayer::setReadout(ReadoutFunction readout_)
+{
+    readout = std::move(readout_);
+    update();
+}
+
+void MarkerLayer::refresh()
+{
+    prepareGeometryChange();
+    update();
+}
+
+void MarkerLayer::clearMarkers()
+{
+    markers.clear();
+    update();
+}
+
+void MarkerLayer::setFrequencyAxis(bool frequencyAxis_)
+{
+    frequencyAxis = frequencyAxis_;
+    hovering = false;
+    update();
+}
+
+QRectF MarkerLayer::boundingRect() const
+{
+    return chart->plotArea();
+}
+
+void MarkerLayer::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+
+    const QRectF area = chart->plotArea();
+    if (area.isEmpty())
+        return;
+
+    painter->save();
+    painter->setClipRect(area);
+
+    const auto readAt =
+    [this](qreal frequency)
+    {
+        return readout ? readout(frequency) : QVector<Readout>();
+    };
+
+    QList<Column> columns;
+    if (hovering)
+    {
+        const QVector<Readout> readouts = readAt(cursorFrequency);
+        const qreal x = toX(cursorFrequency);
+        painter->setPen(QPen(Qt::gray, 0));
+        painter->drawLine(QPointF(x, area.top()), QPointF(x, area.bottom()));
+        paintValues(painter, readouts);
+        columns.push_back({frequencyToString(cursorFrequency), readouts});
+    }
+
+    // every marker is read once, delta markers subtract the values of the reference
+    QList<QVector<Readout>> markerReadouts;
+    for (const Marker& marker : markers)
+        markerReadouts.push_back(readAt(marker.frequency));
+
+    const int reference = referenceMarker();
+    const qreal ascent = QFontMetricsF(painter->font()).ascent();
+    for (int i = 0; i < markers.size(); ++i)
+    {
+        const Marker& marker = markers.at(i);
+        const QString name = (marker.delta ? "D" : "M") + QString::number(i + 1);
+        if (frequencyAxis)
+        {
+            const qreal x = toX(marker.frequency);
+            painter->setPen(QPen(Qt::black, 0, Qt::DashLine));
+            painter->drawLine(QPointF(x, area.top()), QPointF(x, area.bottom()));
+            painter->setPen(Qt::black);
+            painter->drawText(QPointF(x + 2, area.top() + ascent), name);
+        }
+        else
+        {
+            // the name goes next to the first trace the marker is on
+            for (const Readout& readout : markerReadouts.at(i))
+            {
+                if (std::isnan(readout.value))
+                    continue;
+                painter->setPen(Qt::black);
+                painter->drawText(QPointF(toX(readout.point.x()) + DOT_RADIUS, toY(readout.point.y()) - DOT_RADIUS), name);
+                break;
+            }
+        }
+        paintValues(painter, markerReadouts.at(i));
+
+        Column column{name + " " + frequencyToString(marker.frequency), markerReadouts.at(i)};
+        if (marker.delta)
+        {
+            const Marker& base = markers.at(reference);
+            const QVector<Readout>& baseReadouts = markerReadouts.at(reference);
+            column.title = name + " Δ" + frequencyToString(marker.frequency - base.frequency);
+            for (int j = 0; j < column.readouts.size() && j < baseReadouts.size(); ++j)
+                column.readouts[j].value -= baseReadouts.at(j).value;
+        }
+        columns.push_back(column);
+    }
+
+    if (!columns.isEmpty())
+        paintTable(painter, columns);
+
+    painter->restore();
+}
+
+void MarkerLayer::hoverEnterEvent(QGraphicsSceneHoverEvent* event)
+{
+    hoverMoveEvent(event);
+}
+
+void MarkerLayer::hoverMoveEvent(QGraphicsSceneHoverEvent* event)
+{
+    hovering = frequencyAxis && chart->plotArea().contains(event->pos());
+    cursorFrequency = toFrequency(event->pos().x());
+    update();
+}
+
+void MarkerLayer::hoverLeaveEvent(QGraphicsSceneHoverEvent* event)
+{
+    Q_UNUSED(event);
+    hovering = false;
+    update();
+}
+
+void MarkerLayer::mousePressEvent(QGraphicsSceneMouseEvent* event)
+{
+    // other buttons are left to the view, e.g. for the context menu
+    if (event->button() != Qt::LeftButton || !frequencyAxis)
+    {
+        event->ignore();
+        return;
+    }
+
+    const int found = findMarker(event->pos().x());
+    if (found != -1)
+    {
+        const bool wasReference = found == referenceMarker();
+        markers.removeAt(found);
+        // delta markers move to the next ordinary marker or become ordinary ones
+        if (wasReference && referenceMarker() == -1)
+        {
+            for (Marker& marker : markers)
+                marker.delta = false;
+        }
+    }
+    else
+    {
+        const bool delta = (event->modifiers() & Qt::ShiftModifier) && referenceMarker() != -1;
+        markers.push_back({toFrequency(event->pos().x()), delta});
+    }
+
+    update();
+    event->accept();
+}
+
+qreal MarkerLayer::toFrequency(qreal x) const
+{
+    const QRectF area = chart->plotArea();
+    const QValueAxis* axisX = static_cast<QValueAxis*>(chart->axisX());
+    return axisX->min() + (x - area.left()) * (axisX->max() - axisX->min()) / area.width();
+}
+
+qreal MarkerLayer::toX(qreal value) const
+{
+    const QRectF area = chart->plotArea();
+    const QValueAxis* axisX = static_cast<QValueAxis*>(chart->axisX());
+    return area.left() + (value - axisX->min()) * area.width() / (axisX->max() - axisX->min());
+}
+
+qreal MarkerLayer::toY(qreal value) const
+{
+    const QRectF area = chart->plotArea();
+    const QValueAxis* axisY = static_cast<QValueAxis*>(chart->axisY());
+    return area.bottom() - (value - axisY->min()) * area.height() / (axisY->max() - axisY->min());
+}
+
+int MarkerLayer::findMarker(qreal x) const
+{
+    int result = -1;
+    qreal distance = MARKER_PICK_DISTANCE;
+    for (int i = 0; i < markers.size(); ++i)
+    {
+        const qreal markerDistance = qAbs(toX(markers.at(i).frequency) - x);
+        if (markerDistance <= distance)
+        {
+            result = i;
+            distance = markerDistance;
+        }
+    }
+    return result;
+}
+
+int MarkerLayer::referenceMarker() const
+{
+    for (int i = 0; i < markers.size(); ++i)
+    {
+        if (!markers.at(i).delta)
+            return i;
+    }
+    return -1;
+}
+
+void MarkerLayer::paintValues(QPainter* painter, const QVector<Readout>& readouts) const
+{
+    painter->setPen(Qt::NoPen);
+    for (const Readout& readout : readouts)
+    {
+        if (std::isnan(readout.value))
+            continue;
+        painter->setBrush(readout.color);
+        painter->drawEllipse(QPointF(toX(readout.point.x()), toY(readout.point.y())), DOT_RADIUS, DOT_RADIUS);
+    }
+    painter->setBrush(Qt::NoBrush);
+}
+
+void MarkerLayer::paintTable(QPainter* painter, const QList<Column>& columns) const
+{
+    const QRectF area = chart->plotArea();
+    const QFontMetricsF metrics(painter->font());
+    const qreal lineHeight = metrics.height();
+
+    // only rows that fit into the plot area are written,
+    // the last one then tells how many traces are left out
+    const int traces = columns.first().readouts.size();
+    const int fitting = qMax(0, static_cast<int>((area.height() - 2 * (TABLE_MARGIN + TABLE_PADDING)) / lineHeight) - 1);
+    const int rows = traces > fitting ? qMax(0, fitting - 1) : traces;
+
+    // cells of every column including the one of names, headers first
+    QList<QStringList> cells;
+    QStringList names("");
+    for (int row = 0; row < rows; ++row)
+        names.push_back(columns.first().readouts.at(row).name);
+    if (rows < traces)
+        names.push_back("... " + QString::number(traces - rows) + " more");
+    cells.push_back(names);
+    for (const Column& column : columns)
+    {
+        QStringList values(column.title);
+        for (int row = 0; row < rows && row < column.readouts.size(); ++row)
+            values.push_back(valueToString(column.readouts.at(row).value));
+        cells.push_back(values);
+    }
+
+    QVector<qreal> widths;
+    qreal tableWidth = 2 * TABLE_PADDING - COLUMN_GAP;
+    for (const QStringList& column : cells)
+    {
+        qreal width = 0;
+        for (const QString& cell : column)
+            width = qMax(width, metrics.width(cell));
+        widths.push_back(width);
+        tableWidth += width + COLUMN_GAP;
+    }
+    const qreal tableHeight = 2 * TABLE_PADDING + names.size() * lineHeight;
+
+    // the table moves to the right side when the cursor is over it
+    QRectF table(area.left() + TABLE_MARGIN, area.top() + TABLE_MARGIN, tableWidth, tableHeight);
+    const qreal cursorX = toX(cursorFrequency);
+    if (hovering && cursorX >= table.left() && cursorX <= table.right())
+        table.moveRight(area.right() - TABLE_MARGIN);
+
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(QColor(255, 255, 255, 220));
+    painter->drawRect(table);
+    painter->setBrush(Qt::NoBrush);
+
+    qreal x = table.left() + TABLE_PADDING;
+    for (int column = 0; column < cells.size(); ++column)
+    {
+        const QStringList& texts = cells.at(column);
+        for (int row = 0; row < texts.size(); ++row)
+        {
+            // names have the colors of their traces
+            const int trace = row - 1;
+            const bool named = column == 0 && trace >= 0 && trace < rows;
+            painter->setPen(named ? columns.first().readouts.at(trace).color : QColor(Qt::black));
+            painter->drawText(QPointF(x, table.top() + TABLE_PADDING + row * lineHeight + metrics.ascent()),
+                              texts.at(row));
+        }
+        x += widths.at(column) + COLUMN_GAP;
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef MARKERLAYER_H
+#define MARKERLAYER_H
+
+#include <QtCharts/QChart>
+#include <QColor>
+#include <QGraphicsObject>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+// Cursor readout and markers drawn over the plot area of a chart.
+// The values of every trace are read at the frequency under the cursor,
+// so the readout does not depend on hit-testing of series and follows
+// the mouse even with hundreds of traces.
+// A left click places a marker, a click with Shift places a delta marker
+// that shows differences to the first ordinary marker, a click on a marker removes it.
+// Without a frequency axis (polar and Smith charts) markers are only shown
+// as dots on the traces at their frequencies.
+class MarkerLayer
+    : public QGraphicsObject
+{
+    Q_OBJECT
+
+// PUBLIC TYPES
+public:
+    struct Readout
+    {
+        QString name;
+        QColor color;
+        // NaN outside of the trace
+        qreal value;
+        // where the value is drawn, in values of the axes
+        QPointF point;
+    };
+
+    // values of every visible trace at a frequency, in the same order for every frequency
+    typedef std::function<QVector<Readout>(qreal)> ReadoutFunction;
+
+// PRIVATE TYPES
+private:
+    struct Marker
+    {
+        qreal frequency;
+        bool delta;
+    };
+
+    // one column of the readout table
+    struct Column
+    {
+        QString title;
+        QVector<Readout> readouts;
+    };
+
+// PRIVATE FIELDS
+private:
+    QtCharts::QChart* chart;
+    ReadoutFunction readout;
+    QList<Marker> markers;
+
+    // x of the chart is frequency
+    bool frequencyAxis;
+    bool hovering;
+    qreal cursorFrequency;
+
+// PUBLIC METHODS
+public:
+    // markers are positioned by the axes of the chart
+    MarkerLayer(QtCharts::QChart* chart_);
+
+    void setReadout(ReadoutFunction readout_);
+
+    // redraws the layer after traces, axes or the plot area have changed
+    void refresh();
+
+    void clearMarkers();
+
+    // the cursor and placing markers only work along a frequency axis
+    void setFrequencyAxis(bool frequencyAxis_);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+// PROTECTED METHODS
+protected:
+    void hoverEnterEvent(QGraphicsSceneHoverEvent* event) override;
+    void hoverMoveEvent(QGraphicsSceneHoverEvent* event) override;
+    void hoverLeaveEvent(QGraphicsSceneHoverEvent* event) override;
+    void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
+
+// PRIVATE METHODS
+private:
+    // between values of the axes and pixels
+    qreal toFrequency(qreal x) const;
+    qreal toX(qreal value) const;
+    qreal toY(qreal value) const;
+
+    // marker drawn at most MARKER_PICK_DISTANCE pixels from x, -1 if there is none
+    int findMarker(qreal x) const;
+    static const int MARKER_PICK_DISTANCE = 4;
+    // marker delta markers refer to, -1 if there is none
+    int referenceMarker() const;
+
+    // dots of the values of all traces
+    void paintValues(QPainter* painter, const QVector<Readout>& readouts) const;
+    // names of traces with a column of values for the cursor and every marker
+    void paintTable(QPainter* painter, const QList<Column>& columns) const;
+};
+
+#endif // MARKERLAYER_H
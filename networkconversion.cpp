@@ -0,0 +1,632 @@
+#include "networkconversion.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <complex>
+#include <vector>
+
+namespace
+{
+
+const char* const NETWORK_NAMES[] = {
+    "S", "Mixed-Mode S", "Z", "Y", "T", "ABCD"
+};
+
+const char* const NETWORK_PREFIXES[] = {
+    "S", "S", "Z", "Y", "T", "ABCD"
+};
+
+// frequency points computed by one task
+const int BLOCK_SIZE = 1 << 14;
+// every point of a conversion takes matrix inverses, so tasks get fewer of them
+const int CONVERSION_BLOCK_SIZE = 1 << 10;
+
+typedef std::complex<qreal> Complex;
+
+// pivots of smaller magnitude are raised to it, so singular matrices give large finite values
+const qreal MIN_PIVOT = 1e-12;
+// columns of a panel of the blocked LU decomposition
+const int LU_BLOCK = 8;
+
+// one mixed-mode parameter: 0.5 * (pp + sc * pn + sr * np + sr * sc * nn)
+// of the single ended parameters between the ports of two pairs
+struct MixedTerm
+{
+    ParameterSpan pp, pn, np, nn;
+    // signs of the negative ports of the row and the column, -1 for differential mode
+    qreal rowSign;
+    qreal columnSign;
+    Sample* real;
+    Sample* imag;
+};
+
+void mixParameter(const MixedTerm& term, int first, int last)
+{
+    const Sample* __restrict ppr = term.pp.real;
+    const Sample* __restrict ppi = term.pp.imag;
+    const Sample* __restrict pnr = term.pn.real;
+    const Sample* __restrict pni = term.pn.imag;
+    const Sample* __restrict npr = term.np.real;
+    const Sample* __restrict npi = term.np.imag;
+    const Sample* __restrict nnr = term.nn.real;
+    const Sample* __restrict nni = term.nn.imag;
+    Sample* __restrict re = term.real;
+    Sample* __restrict im = term.imag;
+    const qreal sc = term.columnSign;
+    const qreal sr = term.rowSign;
+    const qreal src = sr * sc;
+    for (int i = first; i < last; ++i)
+    {
+        re[i] = static_cast<Sample>(0.5 * (qreal(ppr[i]) + sc * pnr[i] + sr * npr[i] + src * nnr[i]));
+        im[i] = static_cast<Sample>(0.5 * (qreal(ppi[i]) + sc * pni[i] + sr * npi[i] + src * nni[i]));
+    }
+}
+
+// Inverse of the n x n row-major matrix a, which is overwritten by its LU decomposition.
+// N > 0 fixes n at compile time, a panel then spans the whole matrix and the loops unroll.
+// Otherwise panels of LU_BLOCK columns are factored with partial pivoting and the rest
+// of the matrix is updated once per panel.
+template <int N>
+void invert(Complex* __restrict a, Complex* __restrict inverse, int n, int* pivots)
+{
+    if (N > 0)
+        n = N;
+    const int block = N > 0 ? N : LU_BLOCK;
+
+    for (int k0 = 0; k0 < n; k0 += block)
+    {
+        const int k1 = std::min(k0 + block, n);
+        // panel, whole rows are swapped
+        for (int k = k0; k < k1; ++k)
+        {
+            int pivot = k;
+            for (int i = k + 1; i < n; ++i)
+            {
+                if (std::norm(a[i * n + k]) > std::norm(a[pivot * n + k]))
+                    pivot = i;
+            }
+            pivots[k] = pivot;
+            if (pivot != k)
+            {
+                for (int j = 0; j < n; ++j)
+                    std::swap(a[k * n + j], a[pivot * n + j]);
+            }
+            if (std::abs(a[k * n + k]) < MIN_PIVOT)
+                a[k * n + k] = MIN_PIVOT;
+
+            const Complex reciprocal = qreal(1) / a[k * n + k];
+            for (int i = k + 1; i < n; ++i)
+            {
+                const Complex l = a[i * n + k] *= reciprocal;
+                for (int j = k + 1; j < k1; ++j)
+                    a[i * n + j] -= l * a[k * n + j];
+            }
+        }
+        // rows of the panel right of it, L11 U12 = A12
+        for (int k = k0; k < k1; ++k)
+        {
+            for (int i = k + 1; i < k1; ++i)
+            {
+                const Complex l = a[i * n + k];
+                for (int j = k1; j < n; ++j)
+                    a[i * n + j] -= l * a[k * n + j];
+            }
+        }
+        // rest of the matrix, A22 -= L21 U12
+        for (int i = k1; i < n; ++i)
+        {
+            for (int k = k0; k < k1; ++k)
+            {
+                const Complex l = a[i * n + k];
+                for (int j = k1; j < n; ++j)
+                    a[i * n + j] -= l * a[k * n + j];
+            }
+        }
+    }
+
+    // P A = L U, so the inverse is U^-1 L^-1 P: the identity is permuted like the rows
+    // and both triangles are solved for all columns at once
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = 0; j < n; ++j)
+            inverse[i * n + j] = i == j ? 1 : 0;
+    }
+    for (int k = 0; k < n; ++k)
+    {
+        if (pivots[k] != k)
+        {
+            for (int j = 0; j < n; ++j)
+                std::swap(inverse[k * n + j], inverse[pivots[k] * n + j]);
+        }
+    }
+    for (int i = 1; i < n; ++i)
+    {
+        for (int k = 0; k < i; ++k)
+        {
+            const Complex l = a[i * n + k];
+            for (int j = 0; j < n; ++j)
+                inverse[i * n + j] -= l * inverse[k * n + j];
+        }
+    }
+    for (int i = n - 1; i >= 0; --i)
+    {
+        for (int k = i + 1; k < n; ++k)
+        {
+            const Complex u = a[i * n + k];
+            for (int j = 0; j < n; ++j)
+                inverse[i * n + j] -= u * inverse[k * n + j];
+        }
+        const Complex reciprocal = qreal(1) / a[i * n + i];
+        for (int j = 0; j < n; ++j)
+            inverse[i * n + j] *= reciprocal;
+    }
+}
+
+// c = a b of n x n row-major matrices
+template <int N>
+void multiply(const Complex* __restrict a, const Complex* __restrict b, Complex* __restrict c, int n)
+{
+    if (N > 0)
+        n = N;
+    std::fill(c, c + n * n, Complex(0));
+    for (int i = 0; i < n; ++i)
+    {
+        for (int k = 0; k < n; ++k)
+        {
+            const Complex l = a[i * n + k];
+            for (int j = 0; j < n; ++j)
+                c[i * n + j] += l * b[k * n + j];
+        }
+    }
+}
+
+// planes of all parameters of a conversion in row-major order
+struct ConversionPlanes
+{
+    NetworkType type;
+    int dimension;
+    // square roots of the reference impedances
+    std::vector<qreal> roots;
+    std::vector<ParameterSpan> input;
+    std::vector<Sample*> real;
+    std::vector<Sample*> imag;
+};
+
+// every point is gathered into a matrix, converted and scattered back to the planes
+template <int N>
+void convertPoints(const ConversionPlanes& planes, int first, int last)
+{
+    const int n = N > 0 ? N : planes.dimension;
+    const int h = n / 2;
+    const int size = n * n;
+    const int half = h * h;
+    const qreal* roots = planes.roots.data();
+
+    // workspace of the task: s, a, b, inverse, result and the blocks of T and ABCD
+    std::vector<Complex> work(5 * size + 6 * half);
+    std::vector<int> pivots(n);
+    Complex* s = work.data();
+    Complex* a = s + size;
+    Complex* b = a + size;
+    Complex* inverse = b + size;
+    Complex* result = inverse + size;
+    Complex* m11 = result + size;
+    Complex* m12 = m11 + half;
+    Complex* m21 = m12 + half;
+    Complex* m22 = m21 + half;
+    Complex* x = m22 + half;
+    Complex* y = x + half;
+
+    for (int point = first; point < last; ++point)
+    {
+        for (int i = 0; i < size; ++i)
+            s[i] = planes.input[i][point];
+
+        // Z = G (I - S)^-1 (I + S) G and Y = G^-1 (I + S)^-1 (I - S) G^-1, G = diag(sqrt(z0))
+        if (planes.type != NetworkType::T)
+        {
+            const qreal sign = planes.type == NetworkType::Y ? 1 : -1;
+            for (int i = 0; i < n; ++i)
+            {
+                for (int j = 0; j < n; ++j)
+                {
+                    const Complex identity = i == j ? 1 : 0;
+                    a[i * n + j] = identity + sign * s[i * n + j];
+                    b[i * n + j] = identity - sign * s[i * n + j];
+                }
+            }
+            invert<N>(a, inverse, n, pivots.data());
+            multiply<N>(inverse, b, result, n);
+            for (int i = 0; i < n; ++i)
+            {
+                for (int j = 0; j < n; ++j)
+                {
+                    const qreal scale = roots[i] * roots[j];
+                    result[i * n + j] = planes.type == NetworkType::Y ?
+                        result[i * n + j] / scale : result[i * n + j] * scale;
+                }
+            }
+        }
+
+        // T of S and ABCD of Z from blocks between the halves of the ports,
+        // both come from M21^-1 and the products X = M11 M21^-1 and Y = M21^-1 M22
+        if (planes.type == NetworkType::T || planes.type == NetworkType::ABCD)
+        {
+            const Complex* m = planes.type == NetworkType::T ? s : result;
+            for (int i = 0; i < h; ++i)
+            {
+                for (int j = 0; j < h; ++j)
+                {
+                    m11[i * h + j] = m[i * n + j];
+                    m12[i * h + j] = m[i * n + j + h];
+                    m21[i * h + j] = m[(i + h) * n + j];
+                    m22[i * h + j] = m[(i + h) * n + j + h];
+                }
+            }
+            // the inverse of M21 goes to a, m21 is overwritten by its decomposition
+            invert<N / 2>(m21, a, h, pivots.data());
+            multiply<N / 2>(m11, a, x, h);
+            multiply<N / 2>(a, m22, y, h);
+            // X M22 in b
+            multiply<N / 2>(x, m22, b, h);
+
+            // T = [M12 - X M22, X; -Y, M21^-1] and ABCD = [X, X M22 - M12; M21^-1, Y]
+            const bool transfer = planes.type == NetworkType::T;
+            for (int i = 0; i < h; ++i)
+            {
+                for (int j = 0; j < h; ++j)
+                {
+                    const int k = i * h + j;
+                    result[i * n + j] = transfer ? m12[k] - b[k] : x[k];
+                    result[i * n + j + h] = transfer ? x[k] : b[k] - m12[k];
+                    result[(i + h) * n + j] = transfer ? -y[k] : a[k];
+                    result[(i + h) * n + j + h] = transfer ? a[k] : y[k];
+                }
+            }
+        }
+
+        for (int i = 0; i < size; ++i)
+        {
+            planes.real[i][point] = static_cast<Sample>(result[i].real());
+            planes.imag[i][point] = static_cast<Sample>(result[i].imag());
+        }
+    }
+}
+
+// planes of the T-parameters of every factor and of the resulting S-parameters, row-major
+struct CascadePlanes
+{
+    int dimension;
+    std::vector<std::vector<ParameterSpan>> factors;
+    std::vector<bool> inverted;
+    std::vector<Sample*> real;
+    std::vector<Sample*> imag;
+};
+
+template <int N>
+void cascadePoints(const CascadePlanes& planes, int first, int last)
+{
+    const int n = N > 0 ? N : planes.dimension;
+    const int h = n / 2;
+    const int size = n * n;
+    const int half = h * h;
+
+    // workspace of the task: the product, a factor, its inverse, the next product and the blocks
+    std::vector<Complex> work(4 * size + 5 * half);
+    std::vector<int> pivots(n);
+    Complex* product = work.data();
+    Complex* factor = product + size;
+    Complex* inverse = factor + size;
+    Complex* next = inverse + size;
+    Complex* p11 = next + size;
+    Complex* p12 = p11 + half;
+    Complex* p21 = p12 + half;
+    Complex* p22 = p21 + half;
+    Complex* x = p22 + half;
+
+    for (int point = first; point < last; ++point)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            for (int j = 0; j < n; ++j)
+                product[i * n + j] = i == j ? 1 : 0;
+        }
+        for (size_t f = 0; f < planes.factors.size(); ++f)
+        {
+            const std::vector<ParameterSpan>& parameters = planes.factors[f];
+            for (int i = 0; i < size; ++i)
+                factor[i] = parameters[i][point];
+            if (planes.inverted[f])
+            {
+                invert<N>(factor, inverse, n, pivots.data());
+                multiply<N>(product, inverse, next, n);
+            }
+            else
+            {
+                multiply<N>(product, factor, next, n);
+            }
+            std::swap(product, next);
+        }
+
+        // back to S: with c = P22^-1, S = [P12 c, P11 - P12 c P21; c, -c P21]
+        for (int i = 0; i < h; ++i)
+        {
+            for (int j = 0; j < h; ++j)
+            {
+                p11[i * h + j] = product[i * n + j];
+                p12[i * h + j] = product[i * n + j + h];
+                p21[i * h + j] = product[(i + h) * n + j];
+                p22[i * h + j] = product[(i + h) * n + j + h];
+            }
+        }
+        // the inverse of P22 goes to factor, p22 is overwritten by its decomposition
+        Complex* c = factor;
+        invert<N / 2>(p22, c, h, pivots.data());
+        multiply<N / 2>(p12, c, x, h);
+        // P12 c P21 in inverse, -c P21 in p22
+        multiply<N / 2>(x, p21, inverse, h);
+        multiply<N / 2>(c, p21, p22, h);
+        for (int i = 0; i < h; ++i)
+        {
+            for (int j = 0; j < h; ++j)
+            {
+                const int k = i * h + j;
+                const int top = i * n + j;
+                const int bottom = (i + h) * n + j;
+                planes.real[top][point] = static_cast<Sample>(x[k].real());
+                planes.imag[top][point] = static_cast<Sample>(x[k].imag());
+                planes.real[top + h][point] = static_cast<Sample>((p11[k] - inverse[k]).real());
+                planes.imag[top + h][point] = static_cast<Sample>((p11[k] - inverse[k]).imag());
+                planes.real[bottom][point] = static_cast<Sample>(c[k].real());
+                planes.imag[bottom][point] = static_cast<Sample>(c[k].imag());
+                planes.real[bottom + h][point] = static_cast<Sample>(-p22[k].real());
+                planes.imag[bottom + h][point] = static_cast<Sample>(-p22[k].imag());
+            }
+        }
+    }
+}
+
+} // namespace
+
+QStringList networkTypeNames()
+{
+    QStringList result;
+    for (const char* name : NETWORK_NAMES)
+        result.push_back(name);
+    return result;
+}
+
+QString networkTypeToString(NetworkType type)
+{
+    return NETWORK_NAMES[static_cast<int>(type)];
+}
+
+NetworkType stringToNetworkType(QString name, bool* ok)
+{
+    const int index = networkTypeNames().indexOf(name);
+    if (ok)
+        *ok = index != -1;
+    return index == -1 ? NetworkType::S : static_cast<NetworkType>(index);
+}
+
+QString networkTypePrefix(NetworkType type)
+{
+    return NETWORK_PREFIXES[static_cast<int>(type)];
+}
+
+bool isNetworkSupported(NetworkType type, int dimension)
+{
+    switch (type)
+    {
+    case NetworkType::S:
+    case NetworkType::Z:
+    case NetworkType::Y:
+        return dimension > 0;
+    case NetworkType::MixedModeS:
+    case NetworkType::T:
+    case NetworkType::ABCD:
+        return dimension > 0 && dimension % 2 == 0;
+    }
+    return false;
+}
+
+PortPairs defaultPortPairs(int dimension)
+{
+    PortPairs result;
+    if (dimension % 2 != 0)
+        return result;
+    for (int port = 1; port <= dimension / 2; ++port)
+        result.push_back({port, port + dimension / 2});
+    return result;
+}
+
+bool isValidPortPairing(const PortPairs& pairs, int dimension)
+{
+    if (dimension <= 0 || pairs.size() * 2 != dimension)
+        return false;
+    QVector<bool> used(dimension, false);
+    for (const auto& pair : pairs)
+    {
+        for (int port : {pair.first, pair.second})
+        {
+            if (port < 1 || port > dimension || used.at(port - 1))
+                return false;
+            used[port - 1] = true;
+        }
+    }
+    return true;
+}
+
+SParameterData toMixedMode(const SParameterData& data, const PortPairs& pairs)
+{
+    const int dimension = data.getDimension();
+    const int points = data.getPointCount();
+    const int modes = pairs.size();
+    SParameterData result(dimension, points);
+
+    // rows and columns below modes are differential, the others common mode
+    std::vector<MixedTerm> terms;
+    terms.reserve(dimension * dimension);
+    for (int row = 0; row < dimension; ++row)
+    {
+        const std::pair<int, int>& rowPair = pairs.at(row % modes);
+        for (int column = 0; column < dimension; ++column)
+        {
+            const std::pair<int, int>& columnPair = pairs.at(column % modes);
+            const int p = rowPair.first - 1, n = rowPair.second - 1;
+            const int q = columnPair.first - 1, m = columnPair.second - 1;
+            const int index = result.parameterIndex(row, column);
+            terms.push_back({
+                data.parameter(p, q), data.parameter(p, m), data.parameter(n, q), data.parameter(n, m),
+                row < modes ? -1.0 : 1.0,
+                column < modes ? -1.0 : 1.0,
+                result.real(index),
+                result.imag(index)
+            });
+        }
+    }
+
+    // every task computes all parameters of its frequency points
+    std::vector<int> blocks;
+    for (int first = 0; first < points; first += BLOCK_SIZE)
+        blocks.push_back(first);
+    QtConcurrent::blockingMap(blocks, [&](int first) {
+        const int last = qMin(first + BLOCK_SIZE, points);
+        for (const MixedTerm& term : terms)
+            mixParameter(term, first, last);
+    });
+
+    return result;
+}
+
+SParameterData convertNetwork(const SParameterData& data, NetworkType type, const QVector<qreal>& impedances)
+{
+    const int dimension = data.getDimension();
+    const int points = data.getPointCount();
+    SParameterData result(dimension, points);
+
+    ConversionPlanes planes;
+    planes.type = type;
+    planes.dimension = dimension;
+    for (qreal impedance : impedances)
+        planes.roots.push_back(std::sqrt(impedance));
+    for (int row = 0; row < dimension; ++row)
+    {
+        for (int column = 0; column < dimension; ++column)
+        {
+            const int index = result.parameterIndex(row, column);
+            planes.input.push_back(data.parameter(row, column));
+            planes.real.push_back(result.real(index));
+            planes.imag.push_back(result.imag(index));
+        }
+    }
+
+    void (*kernel)(const ConversionPlanes&, int, int) = convertPoints<0>;
+    switch (dimension)
+    {
+    case 1:
+        kernel = convertPoints<1>;
+        break;
+    case 2:
+        kernel = convertPoints<2>;
+        break;
+    case 3:
+        kernel = convertPoints<3>;
+        break;
+    case 4:
+        kernel = convertPoints<4>;
+        break;
+    }
+
+    std::vector<int> blocks;
+    for (int first = 0; first < points; first += CONVERSION_BLOCK_SIZE)
+        blocks.push_back(first);
+    QtConcurrent::blockingMap(blocks, [&](int first) {
+        kernel(planes, first, qMin(first + CONVERSION_BLOCK_SIZE, points));
+    });
+
+    return result;
+}
+
+SParameterData cascadeNetworks(const QList<CascadeFactor>& factors)
+{
+    const int dimension = factors.first().transfer.getDimension();
+    const int points = factors.first().transfer.getPointCount();
+    SParameterData result(dimension, points);
+
+    CascadePlanes planes;
+    planes.dimension = dimension;
+    for (const CascadeFactor& factor : factors)
+    {
+        std::vector<ParameterSpan> parameters;
+        for (int row = 0; row < dimension; ++row)
+        {
+            for (int column = 0; column < dimension; ++column)
+                parameters.push_back(factor.transfer.parameter(row, column));
+        }
+        planes.factors.push_back(parameters);
+        planes.inverted.push_back(factor.inverted);
+    }
+    for (int row = 0; row < dimension; ++row)
+    {
+        for (int column = 0; column < dimension; ++column)
+        {
+            const int index = result.parameterIndex(row, column);
+            planes.real.push_back(result.real(index));
+            planes.imag.push_back(result.imag(index));
+        }
+    }
+
+    void (*kernel)(const CascadePlanes&, int, int) = cascadePoints<0>;
+    switch (dimension)
+    {
+    case 2:
+        kernel = cascadePoints<2>;
+        break;
+    case 4:
+        kernel = cascadePoints<4>;
+        break;
+    }
+
+    std::vector<int> blocks;
+    for (int first = 0; first < points; first += CONVERSION_BLOCK_SIZE)
+        blocks.push_back(first);
+    QtConcurrent::blockingMap(blocks, [&](int first) {
+        kernel(planes, first, qMin(first + CONVERSION_BLOCK_SIZE, points));
+    });
+
+    return result;
+}
+
+SParameterData subtractNetworks(const SParameterData& a, const SParameterData& b)
+{
+    const int dimension = a.getDimension();
+    const int points = a.getPointCount();
+    SParameterData result(dimension, points);
+
+    std::vector<int> blocks;
+    for (int first = 0; first < points; first += BLOCK_SIZE)
+        blocks.push_back(first);
+    QtConcurrent::blockingMap(blocks, [&](int first) {
+        const int last = qMin(first + BLOCK_SIZE, points);
+        for (int row = 0; row < dimension; ++row)
+        {
+            for (int column = 0; column < dimension; ++column)
+            {
+                const ParameterSpan pa = a.parameter(row, column);
+                const ParameterSpan pb = b.parameter(row, column);
+                const int index = result.parameterIndex(row, column);
+                Sample* __restrict re = result.real(index);
+                Sample* __restrict im = result.imag(index);
+                for (int i = first; i < last; ++i)
+                {
+                    re[i] = pa.real[i] - pb.real[i];
+                    im[i] = pa.imag[i] - pb.imag[i];
+                }
+            }
+        }
+    });
+
+    return result;
+}
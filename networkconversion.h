@@ -0,0 +1,80 @@
+#ifndef NETWORKCONVERSION_H
+#define NETWORKCONVERSION_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <utility>
+
+#include "sparameterdata.h"
+
+// Matrix the columns of a file address.
+enum class NetworkType
+{
+    S,
+    // differential and common mode parameters of port pairs,
+    // ordered [[SDD, SDC], [SCD, SCC]]
+    MixedModeS,
+    // impedance and admittance parameters
+    Z,
+    Y,
+    // scattering transfer and chain parameters between the first and the second half of the ports,
+    // [b1, a1] = T [a2, b2], so cascades multiply T, and [V1, I1] = ABCD [V2, -I2]
+    T,
+    ABCD
+};
+
+// names in the order of NetworkType
+QStringList networkTypeNames();
+QString networkTypeToString(NetworkType type);
+// ok is set to false for unknown names
+NetworkType stringToNetworkType(QString name, bool* ok = nullptr);
+// letters trace names of parameters start with
+QString networkTypePrefix(NetworkType type);
+// T and ABCD need an even number of ports, mixed-mode parameters valid port pairs as well
+bool isNetworkSupported(NetworkType type, int dimension);
+
+// 1-based positive and negative port of every differential port
+typedef QList<std::pair<int, int>> PortPairs;
+
+// port k is paired with port k + dimension / 2, empty for an odd dimension
+PortPairs defaultPortPairs(int dimension);
+// every port of the network is in exactly one pair
+bool isValidPortPairing(const PortPairs& pairs, int dimension);
+
+// Mixed-mode parameters S_mm = M S M^T of single ended data, where every row of M
+// takes the difference or the sum of the waves of a pair divided by sqrt(2).
+// M has two entries per row, so every mixed-mode parameter is the sum of four
+// single ended parameters with signs. The products of all frequency points are
+// plain loops over the planes, blocks of frequency points are computed in parallel.
+// All parameters of data have to be allocated and pairs have to be valid.
+SParameterData toMixedMode(const SParameterData& data, const PortPairs& pairs);
+
+// Z, Y, T or ABCD parameters of S-parameters with real reference impedances of every port.
+// Every frequency point takes a complex inverse: matrices of 2, 3 and 4 ports use kernels
+// with the dimension known at compile time, so the compiler unrolls them,
+// larger ones a blocked LU decomposition. Blocks of frequency points are converted in parallel.
+// Singular matrices, e.g. Z of a thru, give large finite values instead of infinities.
+// All parameters of data have to be allocated and type has to be supported.
+SParameterData convertNetwork(const SParameterData& data, NetworkType type, const QVector<qreal>& impedances);
+
+// T-parameters of a network in a cascade, inverted ones are de-embedded
+struct CascadeFactor
+{
+    SParameterData transfer;
+    bool inverted;
+};
+
+// S-parameters of the product of the T-parameters of factors in order,
+// e.g. F1^-1 M F2^-1 de-embeds the fixtures F1 and F2 from the measurement M.
+// Factors need the same dimension and number of points, they are multiplied point by point
+// with the same compile time kernels as convertNetwork, blocks of points in parallel.
+SParameterData cascadeNetworks(const QList<CascadeFactor>& factors);
+
+// difference a - b of every parameter, both with all parameters allocated,
+// the same dimension and number of points; blocks of points are computed in parallel
+SParameterData subtractNetworks(const SParameterData& a, const SParameterData& b);
+
+#endif // NETWORKCONVERSION_H
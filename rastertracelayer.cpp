@@ -0,0 +1,149 @@
+#include "rastertracelayer.h"
+
+#include <QPainter>
+#include <QPolygonF>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+
+RasterTraceLayer::RasterTraceLayer(QGraphicsItem* parent)
+    : QGraphicsObject(parent)
+    , watcher(new QFutureWatcher<QVector<Tile>>(this))
+    , hasQueued(false)
+{
+    connect(watcher, &QFutureWatcherBase::finished, this, &RasterTraceLayer::finishRendering);
+}
+
+RasterTraceLayer::~RasterTraceLayer()
+{
+    // tasks only use their own copy of the request, but the result has nowhere to go
+    disconnect(watcher, nullptr, this, nullptr);
+    watcher->waitForFinished();
+}
+
+void RasterTraceLayer::render(QList<Trace> traces, QRectF area, QRectF range)
+{
+    Request request{std::move(traces), area, range};
+    if (watcher->isRunning())
+    {
+        queued = std::move(request);
+        hasQueued = true;
+        return;
+    }
+    start(std::move(request));
+}
+
+void RasterTraceLayer::start(Request request)
+{
+    watcher->setFuture(QtConcurrent::run([request]() { return renderTiles(request); }));
+}
+
+void RasterTraceLayer::finishRendering()
+{
+    // results of an outdated request are still shown until the next one is ready
+    prepareGeometryChange();
+    tiles = watcher->result();
+    update();
+
+    if (hasQueued)
+    {
+        hasQueued = false;
+        start(std::move(queued));
+        queued = Request();
+    }
+}
+
+QRectF RasterTraceLayer::boundingRect() const
+{
+    QRectF result;
+    for (const Tile& tile : tiles)
+        result |= QRectF(tile.rect);
+    return result;
+}
+
+void RasterTraceLayer::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+    for (const Tile& tile : tiles)
+        painter->drawImage(tile.rect.topLeft(), tile.image);
+}
+
+QVector<RasterTraceLayer::Tile> RasterTraceLayer::renderTiles(const Request& request)
+{
+    QVector<Tile> result;
+    const QRect area = request.area.toAlignedRect();
+    if (area.isEmpty() || request.range.width() <= 0 || request.range.height() <= 0)
+        return result;
+
+    // one vertical strip per thread, tiles are positioned in parent coordinates
+    const int count = qMax(1, qMin(QThread::idealThreadCount(), area.width()));
+    for (int i = 0; i < count; ++i)
+    {
+        const int left = area.left() + area.width() * i / count;
+        const int right = area.left() + area.width() * (i + 1) / count;
+        result.push_back({QRect(left, area.top(), right - left, area.height()), QImage()});
+    }
+
+    QtConcurrent::blockingMap(result, [&request](Tile& tile) { renderTile(request, tile); });
+    return result;
+}
+
+void RasterTraceLayer::renderTile(const Request& request, Tile& tile)
+{
+    tile.image = QImage(tile.rect.size(), QImage::Format_ARGB32_Premultiplied);
+    tile.image.fill(Qt::transparent);
+
+    QPainter painter(&tile.image);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    // values are mapped to pixels of the tile
+    const QRectF& area = request.area;
+    const QRectF& range = request.range;
+    const qreal xScale = area.width() / range.width();
+    const qreal yScale = area.height() / range.height();
+    const qreal xOffset = area.left() - tile.rect.left();
+    const qreal yOffset = area.top() - tile.rect.top();
+
+    // values seen in the tile, a line may reach in from a point just outside of it
+    const qreal xFirst = range.left() + (tile.rect.left() - area.left()) / xScale;
+    const qreal xLast = range.left() + (tile.rect.right() + 1 - area.left()) / xScale;
+    const auto byX =
+    [](const QPointF& point, qreal x)
+    {
+        return point.x() < x;
+    };
+
+    for (const Trace& trace : request.traces)
+    {
+        const QVector<QPointF>& points = trace.points;
+        auto first = points.cbegin();
+        auto last = points.cend();
+        if (trace.sorted)
+        {
+            first = std::lower_bound(points.cbegin(), points.cend(), xFirst, byX);
+            last = std::lower_bound(first, points.cend(), xLast, byX);
+            if (first != points.cbegin())
+                --first;
+            if (last != points.cend())
+                ++last;
+        }
+        if (last - first < 2)
+            continue;
+
+        QPolygonF polyline;
+        polyline.reserve(static_cast<int>(last - first));
+        for (auto point = first; point != last; ++point)
+        {
+            polyline.push_back(QPointF(
+                xOffset + (point->x() - range.left()) * xScale,
+                yOffset + (range.bottom() - point->y()) * yScale
+            ));
+        }
+
+        painter.setPen(trace.pen);
+        painter.drawPolyline(polyline);
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef RASTERTRACELAYER_H
+#define RASTERTRACELAYER_H
+
+#include <QFutureWatcher>
+#include <QGraphicsObject>
+#include <QImage>
+#include <QList>
+#include <QPen>
+#include <QPointF>
+#include <QRect>
+#include <QRectF>
+#include <QVector>
+
+// Draws traces into images on worker threads instead of through the scene of the chart.
+// The plot is cut into vertical tiles, every tile is rasterized by its own task
+// with QPainter on a QImage, so no GPU is needed, and the finished tiles
+// are composited on the GUI thread when the item is painted.
+class RasterTraceLayer
+    : public QGraphicsObject
+{
+    Q_OBJECT
+
+// PUBLIC TYPES
+public:
+    struct Trace
+    {
+        // in values of the axes
+        QVector<QPointF> points;
+        QPen pen;
+        // x is ascending, so every tile draws only its part of the trace
+        bool sorted;
+    };
+
+// PRIVATE TYPES
+private:
+    struct Tile
+    {
+        // in pixels of the plot area
+        QRect rect;
+        QImage image;
+    };
+
+    struct Request
+    {
+        QList<Trace> traces;
+        // plot area in coordinates of the parent item
+        QRectF area;
+        // values shown in the plot area
+        QRectF range;
+    };
+
+// PRIVATE FIELDS
+private:
+    // tiles of the last finished rendering
+    QVector<Tile> tiles;
+
+    QFutureWatcher<QVector<Tile>>* watcher;
+    // a request that came while rendering was in progress, only the last one is kept
+    Request queued;
+    bool hasQueued;
+
+// PUBLIC METHODS
+public:
+    RasterTraceLayer(QGraphicsItem* parent = nullptr);
+    ~RasterTraceLayer();
+
+    // starts rendering traces into area (in coordinates of the parent item),
+    // range is the rectangle of values the area shows
+    void render(QList<Trace> traces, QRectF area, QRectF range);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+// PRIVATE METHODS
+private:
+    void start(Request request);
+    void finishRendering();
+
+    static QVector<Tile> renderTiles(const Request& request);
+    static void renderTile(const Request& request, Tile& tile);
+};
+
+#endif // RASTERTRACELAYER_H
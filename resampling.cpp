@@ -0,0 +1,203 @@
+#include "resampling.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtMath>
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "displayformat.h"
+
+namespace
+{
+
+const char* const INTERPOLATION_NAMES[] = {
+    "Linear", "Cubic", "Linear Mag/Phase", "Cubic Mag/Phase"
+};
+
+// target points of one parameter computed by one task
+const int BLOCK_SIZE = 1 << 14;
+
+bool isCubic(Interpolation interpolation)
+{
+    return interpolation == Interpolation::Cubic || interpolation == Interpolation::CubicMagnitudePhase;
+}
+
+bool isPolar(Interpolation interpolation)
+{
+    return interpolation == Interpolation::LinearMagnitudePhase ||
+           interpolation == Interpolation::CubicMagnitudePhase;
+}
+
+// weighted sums of the source samples of the target points [first, last)
+// TAPS is known at compile time, so the inner loop unrolls
+template <int TAPS>
+void interpolate(const ResamplingPlan& plan, const Sample* __restrict source, Sample* __restrict target,
+                 int first, int last)
+{
+    const int* __restrict indices[TAPS];
+    const qreal* __restrict weights[TAPS];
+    for (int tap = 0; tap < TAPS; ++tap)
+    {
+        indices[tap] = plan.indices[tap].constData();
+        weights[tap] = plan.weights[tap].constData();
+    }
+    for (int i = first; i < last; ++i)
+    {
+        qreal value = 0;
+        for (int tap = 0; tap < TAPS; ++tap)
+            value += weights[tap][i] * source[indices[tap][i]];
+        target[i] = static_cast<Sample>(value);
+    }
+}
+
+// magnitude and phase in degrees back to real and imaginary parts, in place
+// cubic curves may overshoot below zero magnitude, which would turn the phase around
+void polarToCartesian(Sample* __restrict re, Sample* __restrict im, int first, int last)
+{
+    for (int i = first; i < last; ++i)
+    {
+        const qreal magnitude = qMax(qreal(0), qreal(re[i]));
+        const qreal angle = qreal(im[i]) * (M_PI / 180);
+        re[i] = static_cast<Sample>(magnitude * std::cos(angle));
+        im[i] = static_cast<Sample>(magnitude * std::sin(angle));
+    }
+}
+
+} // namespace
+
+QStringList interpolationNames()
+{
+    QStringList result;
+    for (const char* name : INTERPOLATION_NAMES)
+        result.push_back(name);
+    return result;
+}
+
+QString interpolationToString(Interpolation interpolation)
+{
+    return INTERPOLATION_NAMES[static_cast<int>(interpolation)];
+}
+
+Interpolation stringToInterpolation(QString name, bool* ok)
+{
+    const int index = interpolationNames().indexOf(name);
+    if (ok)
+        *ok = index != -1;
+    return index == -1 ? Interpolation::Linear : static_cast<Interpolation>(index);
+}
+
+ResamplingPlan planResampling(const QVector<qreal>& source, const QVector<qreal>& target,
+                              Interpolation interpolation)
+{
+    ResamplingPlan plan;
+    plan.interpolation = interpolation;
+    plan.taps = isCubic(interpolation) ? 4 : 2;
+    plan.points = target.size();
+    for (int tap = 0; tap < plan.taps; ++tap)
+    {
+        plan.indices[tap].resize(plan.points);
+        plan.weights[tap].resize(plan.points);
+    }
+    const auto setTap =
+    [&plan](int tap, int point, int index, qreal weight)
+    {
+        plan.indices[tap][point] = index;
+        plan.weights[tap][point] = weight;
+    };
+
+    const qreal* x = source.constData();
+    const int last = source.size() - 1;
+    // interval [x[j], x[j + 1]] of the target point, both sweeps ascend, so j only moves forward
+    int j = 0;
+    for (int i = 0; i < plan.points; ++i)
+    {
+        const qreal frequency = target.at(i);
+        while (j < last - 1 && x[j + 1] <= frequency)
+            ++j;
+        const int next = qMin(j + 1, last);
+        const qreal h = x[next] - x[j];
+        const qreal t = h > 0 ? qBound(qreal(0), (frequency - x[j]) / h, qreal(1)) : 0;
+        if (plan.taps == 2)
+        {
+            setTap(0, i, j, 1 - t);
+            setTap(1, i, next, t);
+            continue;
+        }
+
+        // Hermite basis, the slope at a point is the one of the secant through its neighbors,
+        // neighbors beyond the sweep are clamped, so the ends take the slope of their interval
+        const int previous = qMax(j - 1, 0);
+        const int after = qMin(next + 1, last);
+        const qreal t2 = t * t;
+        const qreal t3 = t2 * t;
+        const qreal h00 = 2 * t3 - 3 * t2 + 1;
+        const qreal h10 = t3 - 2 * t2 + t;
+        const qreal h01 = 3 * t2 - 2 * t3;
+        const qreal h11 = t3 - t2;
+        const qreal spanBefore = x[next] - x[previous];
+        const qreal spanAfter = x[after] - x[j];
+        const qreal a = spanBefore > 0 ? h10 * h / spanBefore : 0;
+        const qreal b = spanAfter > 0 ? h11 * h / spanAfter : 0;
+        setTap(0, i, previous, -a);
+        setTap(1, i, j, h00 - b);
+        setTap(2, i, next, h01 + a);
+        setTap(3, i, after, b);
+    }
+    return plan;
+}
+
+SParameterData resample(const SParameterData& data, const ResamplingPlan& plan)
+{
+    const int parameters = data.getParameterCount();
+    const int points = plan.points;
+    SParameterData result(data.getDimension(), points, data.isSymmetric());
+
+    // magnitude and unwrapped phase take the places of the real and imaginary planes
+    const bool polar = isPolar(plan.interpolation);
+    SParameterData polarData;
+    if (polar)
+    {
+        polarData = SParameterData(data.getDimension(), data.getPointCount(), data.isSymmetric());
+        for (int parameter = 0; parameter < parameters; ++parameter)
+        {
+            computeDisplayFormat(DisplayFormat::Magnitude, data.parameter(parameter), polarData.real(parameter));
+            computeDisplayFormat(DisplayFormat::UnwrappedPhase, data.parameter(parameter), polarData.imag(parameter));
+        }
+    }
+    const SParameterData& source = polar ? polarData : data;
+
+    void (*kernel)(const ResamplingPlan&, const Sample*, Sample*, int, int) =
+        plan.taps == 4 ? interpolate<4> : interpolate<2>;
+
+    // blocks of all parameters, so files with few ports use all cores as well
+    std::vector<std::pair<int, int>> blocks;
+    for (int parameter = 0; parameter < parameters; ++parameter)
+    {
+        for (int first = 0; first < points; first += BLOCK_SIZE)
+            blocks.push_back({parameter, first});
+    }
+    QtConcurrent::blockingMap(blocks, [&](const std::pair<int, int>& block) {
+        const int parameter = block.first;
+        const int last = qMin(block.second + BLOCK_SIZE, points);
+        kernel(plan, source.real(parameter), result.real(parameter), block.second, last);
+        kernel(plan, source.imag(parameter), result.imag(parameter), block.second, last);
+        if (polar)
+            polarToCartesian(result.real(parameter), result.imag(parameter), block.second, last);
+    });
+
+    return result;
+}
+
+bool isSameSweep(const QVector<qreal>& frequencies, const QVector<qreal>& other, qreal tolerance)
+{
+    if (frequencies.size() != other.size())
+        return false;
+    for (int i = 0; i < frequencies.size(); ++i)
+    {
+        if (qAbs(frequencies.at(i) - other.at(i)) > tolerance)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef RESAMPLING_H
+#define RESAMPLING_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "sparameterdata.h"
+
+// How samples between the points of a sweep are estimated.
+enum class Interpolation
+{
+    // straight lines between neighboring points
+    Linear,
+    // cubic Hermite curves with the slopes of the neighboring points (Catmull-Rom)
+    Cubic,
+    // the same on magnitude and unwrapped phase instead of real and imaginary parts,
+    // so samples that rotate between points, e.g. of long lines, keep their magnitude
+    LinearMagnitudePhase,
+    CubicMagnitudePhase
+};
+
+// names in the order of Interpolation
+QStringList interpolationNames();
+QString interpolationToString(Interpolation interpolation);
+// ok is set to false for unknown names
+Interpolation stringToInterpolation(QString name, bool* ok = nullptr);
+
+// Where the points of a target sweep lie on a source sweep: every target point is
+// a weighted sum of two (linear) or four (cubic) source points.
+// The plan only depends on the frequencies, so it is built once for all parameters.
+struct ResamplingPlan
+{
+    static const int MAX_TAPS = 4;
+
+    Interpolation interpolation = Interpolation::Linear;
+    int taps = 2;
+    int points = 0;
+    // source point and its weight of every tap for every target point,
+    // separate arrays per tap, so the kernel reads them contiguously
+    QVector<int> indices[MAX_TAPS];
+    QVector<qreal> weights[MAX_TAPS];
+};
+
+// Both sweeps are ascending, source has at least one point.
+// Targets are found in one merge walk over both sweeps. Targets outside of the source
+// sweep take the value of its nearest end.
+ResamplingPlan planResampling(const QVector<qreal>& source, const QVector<qreal>& target,
+                              Interpolation interpolation);
+
+// Samples of every parameter at the target points of plan. The kernel is a plain loop over
+// the arrays of the plan for blocks of target points, blocks of all parameters are computed in parallel.
+// Magnitude and phase modes unwrap the phase of every parameter first.
+// All parameters of data have to be allocated and data has to have the points of the source sweep.
+SParameterData resample(const SParameterData& data, const ResamplingPlan& plan);
+
+// both sweeps have the same number of points, at most tolerance apart
+bool isSameSweep(const QVector<qreal>& frequencies, const QVector<qreal>& other, qreal tolerance);
+
+#endif // RESAMPLING_H
@@ -0,0 +1,330 @@
+#include "snpcache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+
+#include <cstring>
+#include <memory>
+
+#include "filesnpdata.h"
+
+namespace
+{
+
+const char MAGIC[8] = {'S', 'N', 'P', 'C', 'A', 'C', 'H', 'E'};
+// increase whenever the layout or the meaning of stored data changes
+const quint32 VERSION = 5;
+const char ENTRY_EXTENSION[] = ".snpcache";
+
+const char INDEX_MAGIC[8] = {'S', 'N', 'P', 'I', 'N', 'D', 'E', 'X'};
+const quint32 INDEX_VERSION = 1;
+const char INDEX_EXTENSION[] = ".snpindex";
+const quint32 BYTE_ORDER_MARK = 0x01020304;
+// arrays start at cache line boundaries of the mapped file
+const qint64 ALIGNMENT = SParameterData::ALIGNMENT;
+
+// Index layout, QDataStream:
+//   magic, version, source size and modification time, file path,
+//   record size, interval, records, offsets, frequencies
+//
+// Entry layout:
+//   CacheHeader
+//   metadata  - QDataStream: file path, description, data header,
+//               frequency scale, parameter type and format of the source,
+//               port references, symmetric storage flag
+//   frequencies  - qreal[records]
+//   data points  - SParameterData buffer: real and imaginary planes
+//                  of every parameter, SParameterData::planeStride apart,
+//                  samples of the type the application was built with
+struct CacheHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    qint64 sourceSize;
+    qint64 sourceModified;
+    qint32 dimension;
+    qint32 records;
+    // entries of builds with another sample type are rebuilt
+    qint32 sampleSize;
+    double z0;
+    qint64 metadataOffset;
+    qint64 metadataSize;
+    qint64 frequenciesOffset;
+    qint64 dataOffset;
+    qint64 totalSize;
+};
+
+qint64 align(qint64 offset)
+{
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+} // namespace
+
+SNPCache::SNPCache()
+{
+    QSettings settings;
+    enabled = settings.value("cache/enabled", true).toBool();
+    location = settings.value(
+        "cache/location",
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/snp"
+    ).toString();
+    maxSize = settings.value("cache/maxSizeMB", 2048).toLongLong() * 1024 * 1024;
+}
+
+bool SNPCache::read(FileSNPData& file) const
+{
+    if (!enabled)
+        return false;
+
+    // the entry stays mapped for as long as the data points are used,
+    // a private mapping gives the writable pointer SParameterData keeps
+    std::shared_ptr<QFile> entry = std::make_shared<QFile>(entryPath(file.filePath, ENTRY_EXTENSION));
+    if (!entry->open(QIODevice::ReadOnly))
+        return false;
+    const qint64 size = entry->size();
+    if (size < static_cast<qint64>(sizeof(CacheHeader)))
+        return false;
+    char* data = reinterpret_cast<char*>(entry->map(0, size, QFileDevice::MapPrivateOption));
+    if (!data)
+        return false;
+
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    // stale or foreign entries are simply rebuilt
+    QFileInfo source(file.filePath);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION ||
+        header.byteOrder != BYTE_ORDER_MARK ||
+        header.sampleSize != static_cast<qint32>(sizeof(Sample)) ||
+        header.totalSize != size ||
+        header.sourceSize != source.size() ||
+        header.sourceModified != source.lastModified().toMSecsSinceEpoch())
+        return false;
+
+    if (header.dimension <= 0 || header.records < 0 ||
+        header.metadataOffset + header.metadataSize > size)
+        return false;
+
+    QString filePath, dataHeader;
+    QStringList fileDescription;
+    SNPOptions options;
+    QVector<qreal> references;
+    bool symmetric;
+    {
+    QByteArray metadata = QByteArray::fromRawData(data + header.metadataOffset,
+                                                  static_cast<int>(header.metadataSize));
+    QDataStream in(metadata);
+    in.setVersion(QDataStream::Qt_5_0);
+    qint32 parameter, format;
+    in >> filePath >> fileDescription >> dataHeader
+       >> options.frequencyScale >> parameter >> format
+       >> references >> symmetric;
+    options.parameter = static_cast<SNPOptions::Parameter>(parameter);
+    options.format = static_cast<SNPOptions::Format>(format);
+    options.z0 = header.z0;
+    // hash collisions are not trusted
+    if (in.status() != QDataStream::Ok || filePath != QFileInfo(file.filePath).absoluteFilePath())
+        return false;
+    }
+
+    // symmetric storage keeps only one triangle of the matrix
+    const qint64 dimension = header.dimension;
+    const qint64 planes = symmetric ? dimension * (dimension + 1) : 2 * dimension * dimension;
+    const qint64 frequenciesSize = header.records * qint64(sizeof(qreal));
+    const qint64 dataSize = planes * SParameterData::planeStride(header.records) * qint64(sizeof(Sample));
+    if (header.frequenciesOffset + frequenciesSize > size ||
+        header.dataOffset % SParameterData::ALIGNMENT != 0 ||
+        header.dataOffset + dataSize > size)
+        return false;
+
+    file.fileDescription = fileDescription;
+    file.dataHeader = dataHeader;
+    file.options = options;
+    file.references = references;
+    file.dimension = header.dimension;
+
+    file.frequencies.resize(header.records);
+    std::memcpy(file.frequencies.data(), data + header.frequenciesOffset, frequenciesSize);
+
+    // data points are used in place, nothing is copied
+    file.dataPoints = SParameterData(
+        header.dimension,
+        header.records,
+        symmetric,
+        std::shared_ptr<Sample>(reinterpret_cast<Sample*>(data + header.dataOffset), [entry](Sample*) {})
+    );
+
+    return true;
+}
+
+bool SNPCache::write(const FileSNPData& file) const
+{
+    if (!enabled || !QDir().mkpath(location))
+        return false;
+
+    QFileInfo source(file.filePath);
+
+    QByteArray metadata;
+    {
+    QDataStream out(&metadata, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << source.absoluteFilePath() << file.fileDescription << file.dataHeader
+        << file.options.frequencyScale
+        << static_cast<qint32>(file.options.parameter)
+        << static_cast<qint32>(file.options.format)
+        << file.references << file.dataPoints.isSymmetric();
+    }
+
+    const qint64 records = file.frequencies.size();
+    const qint64 dataSize = file.dataPoints.planeCount() * file.dataPoints.planeStride() * qint64(sizeof(Sample));
+
+    CacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.sourceSize = source.size();
+    header.sourceModified = source.lastModified().toMSecsSinceEpoch();
+    header.dimension = file.dimension;
+    header.records = static_cast<qint32>(records);
+    header.sampleSize = static_cast<qint32>(sizeof(Sample));
+    header.z0 = file.options.z0;
+    header.metadataOffset = sizeof(header);
+    header.metadataSize = metadata.size();
+    header.frequenciesOffset = align(header.metadataOffset + header.metadataSize);
+    header.dataOffset = align(header.frequenciesOffset + records * qint64(sizeof(qreal)));
+    header.totalSize = header.dataOffset + dataSize;
+
+    // an entry this big would push everything else out
+    if (header.totalSize > maxSize)
+        return false;
+
+    QSaveFile entry(entryPath(file.filePath, ENTRY_EXTENSION));
+    if (!entry.open(QIODevice::WriteOnly))
+        return false;
+
+    const auto writeAt =
+    [&entry](qint64 offset, const void* data, qint64 size)
+    {
+        if (entry.pos() < offset)
+            entry.write(QByteArray(static_cast<int>(offset - entry.pos()), '\0'));
+        entry.write(static_cast<const char*>(data), size);
+    };
+
+    writeAt(0, &header, sizeof(header));
+    writeAt(header.metadataOffset, metadata.constData(), metadata.size());
+    writeAt(header.frequenciesOffset, file.frequencies.constData(), records * qint64(sizeof(qreal)));
+    writeAt(header.dataOffset, file.dataPoints.data(), dataSize);
+
+    // QSaveFile replaces the old entry atomically, readers never see half of it
+    if (!entry.commit())
+        return false;
+
+    trim(entry.fileName());
+    return true;
+}
+
+bool SNPCache::readIndex(QString filePath, SparseIndex& index) const
+{
+    if (!enabled)
+        return false;
+
+    QFile entry(entryPath(filePath, INDEX_EXTENSION));
+    if (!entry.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&entry);
+    in.setVersion(QDataStream::Qt_5_0);
+    char magic[sizeof(INDEX_MAGIC)];
+    if (in.readRawData(magic, sizeof(magic)) != sizeof(magic) ||
+        std::memcmp(magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+        return false;
+
+    quint32 version;
+    qint64 sourceSize, sourceModified;
+    QString sourcePath;
+    in >> version >> sourceSize >> sourceModified >> sourcePath;
+
+    QFileInfo source(filePath);
+    if (in.status() != QDataStream::Ok ||
+        version != INDEX_VERSION ||
+        sourceSize != source.size() ||
+        sourceModified != source.lastModified().toMSecsSinceEpoch() ||
+        sourcePath != source.absoluteFilePath())
+        return false;
+
+    SparseIndex result;
+    in >> result.recordSize >> result.interval >> result.records
+       >> result.offsets >> result.frequencies;
+    if (in.status() != QDataStream::Ok ||
+        result.recordSize <= 0 || result.interval <= 0 || result.records <= 0 ||
+        result.offsets.size() != (result.records + result.interval - 1) / result.interval ||
+        result.frequencies.size() != result.offsets.size())
+        return false;
+
+    index = result;
+    return true;
+}
+
+bool SNPCache::writeIndex(QString filePath, const SparseIndex& index) const
+{
+    if (!enabled || !QDir().mkpath(location))
+        return false;
+
+    QSaveFile entry(entryPath(filePath, INDEX_EXTENSION));
+    if (!entry.open(QIODevice::WriteOnly))
+        return false;
+
+    QFileInfo source(filePath);
+    QDataStream out(&entry);
+    out.setVersion(QDataStream::Qt_5_0);
+    out.writeRawData(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    out << INDEX_VERSION
+        << source.size() << source.lastModified().toMSecsSinceEpoch() << source.absoluteFilePath()
+        << index.recordSize << index.interval << index.records
+        << index.offsets << index.frequencies;
+
+    if (!entry.commit())
+        return false;
+
+    trim(entry.fileName());
+    return true;
+}
+
+QString SNPCache::entryPath(QString filePath, QString extension) const
+{
+    QByteArray key = QCryptographicHash::hash(
+        QFileInfo(filePath).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1
+    ).toHex();
+    return location + "/" + QString::fromLatin1(key) + extension;
+}
+
+void SNPCache::trim(QString keptEntry) const
+{
+    // newest entries first
+    QFileInfoList entries = QDir(location).entryInfoList(
+        QStringList() << QString("*") + ENTRY_EXTENSION << QString("*") + INDEX_EXTENSION,
+        QDir::Files, QDir::Time
+    );
+
+    qint64 total = 0;
+    for (const QFileInfo& entry : entries)
+    {
+        total += entry.size();
+        if (total > maxSize && entry.absoluteFilePath() != QFileInfo(keptEntry).absoluteFilePath())
+        {
+            QFile::remove(entry.absoluteFilePath());
+            total -= entry.size();
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef SNPCACHE_H
+#define SNPCACHE_H
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+class FileSNPData;
+
+// Binary copies of parsed sNp files, so that files opened before
+// are loaded by mapping the copy instead of running the text parser.
+// An entry is found by the absolute file path and is rebuilt as soon as
+// the size or modification time of the source file changes.
+// Next to an entry the cache keeps a sparse index of the records of the
+// source file, so that a frequency band can be read without a full scan.
+//
+// Configured with QSettings:
+//   cache/enabled    - default true
+//   cache/location   - default <CacheLocation>/snp
+//   cache/maxSizeMB  - default 2048, oldest entries are removed first
+class SNPCache
+{
+// PUBLIC TYPES
+public:
+    // every interval-th record of the data section of a source file
+    struct SparseIndex
+    {
+        // numbers in one record
+        qint32 recordSize;
+        // records between two entries
+        qint32 interval;
+        qint32 records;
+        // file offset and frequency (in units of the file) of every entry
+        QVector<qint64> offsets;
+        QVector<qreal> frequencies;
+    };
+
+// PRIVATE FIELDS
+private:
+    bool enabled;
+    QString location;
+    qint64 maxSize;
+
+// PUBLIC METHODS
+public:
+    SNPCache();
+
+    // fills file from its entry, returns false if there is no valid entry
+    bool read(FileSNPData& file) const;
+
+    // stores parsed file, returns false if the entry was not written
+    bool write(const FileSNPData& file) const;
+
+    // returns false if the source file has no valid index
+    bool readIndex(QString filePath, SparseIndex& index) const;
+
+    bool writeIndex(QString filePath, const SparseIndex& index) const;
+
+// PRIVATE METHODS
+private:
+    QString entryPath(QString filePath, QString extension) const;
+
+    // removes the oldest entries until the cache fits maxSize
+    void trim(QString keptEntry) const;
+};
+
+#endif // SNPCACHE_H
@@ -0,0 +1,471 @@
+#include "snpparser.h"
+
+#include <QRegExp>
+#include <QStringList>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+// powers of ten that are exactly representable as double
+const double EXACT_POWERS_OF_10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+const int MAX_EXACT_POWER = 22;
+const quint64 MAX_EXACT_MANTISSA = quint64(1) << 53;
+const int MAX_MANTISSA_DIGITS = 19;
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+} // namespace
+
+SNPOptions SNPOptions::parse(QString line)
+{
+    SNPOptions options;
+
+    // options may come in any order and in any case,
+    // a comment can follow them
+    QString optionText = line.mid(line.indexOf('#') + 1);
+    int comment = optionText.indexOf('!');
+    if (comment != -1)
+        optionText.truncate(comment);
+    QStringList tokens = optionText.toUpper().split(QRegExp("\\s+"), QString::SkipEmptyParts);
+
+    for (int i = 0; i < tokens.size(); ++i)
+    {
+        const QString& token = tokens.at(i);
+        if (token == "HZ")
+            options.frequencyScale = 1;
+        else if (token == "KHZ")
+            options.frequencyScale = 1e3;
+        else if (token == "MHZ")
+            options.frequencyScale = 1e6;
+        else if (token == "GHZ")
+            options.frequencyScale = 1e9;
+        else if (token == "S")
+            options.parameter = Parameter::S;
+        else if (token == "Y")
+            options.parameter = Parameter::Y;
+        else if (token == "Z")
+            options.parameter = Parameter::Z;
+        else if (token == "H")
+            options.parameter = Parameter::H;
+        else if (token == "G")
+            options.parameter = Parameter::G;
+        else if (token == "RI")
+            options.format = Format::RI;
+        else if (token == "MA")
+            options.format = Format::MA;
+        else if (token == "DB")
+            options.format = Format::DB;
+        else if (token == "R" && i + 1 < tokens.size())
+        {
+            bool ok;
+            options.z0 = tokens.at(++i).toDouble(&ok);
+            if (!ok || options.z0 <= 0)
+                throw std::domain_error("Incorrect reference resistance in the option line.");
+        }
+        else
+            throw std::domain_error("Unknown option \"" + token.toStdString() + "\" in the option line.");
+    }
+
+    return options;
+}
+
+SNPParser::SNPParser(const char* begin_, const char* end_)
+    : begin(begin_)
+    , end(end_)
+    , pos(begin_)
+{
+}
+
+SNPParser::SNPParser(const char* begin_, const char* pos_, const char* end_)
+    : begin(begin_)
+    , end(end_)
+    , pos(pos_)
+{
+}
+
+char SNPParser::peek() const
+{
+    return pos == end ? 0 : *pos;
+}
+
+char SNPParser::skipBlank()
+{
+    while (pos != end && isSpace(*pos))
+        ++pos;
+    return peek();
+}
+
+SNPHeader SNPParser::readHeader()
+{
+    SNPHeader header;
+
+    while (peek() == '!')
+        header.description.push_back(readLine());
+
+    bool optionsRead = false;
+    bool orderGiven = false;
+    forever
+    {
+        const char c = skipBlank();
+        if (c == '!')
+        {
+            readLine();
+        }
+        else if (c == '#')
+        {
+            // only the first option line counts
+            QString line = readLine();
+            if (!optionsRead)
+            {
+                header.optionLine = line;
+                header.options = SNPOptions::parse(line);
+                optionsRead = true;
+            }
+        }
+        else if (c == '[')
+        {
+            QString line = readLine();
+            int comment = line.indexOf('!');
+            if (comment != -1)
+                line.truncate(comment);
+
+            const int nameEnd = line.indexOf(']');
+            if (nameEnd == -1)
+                throw std::domain_error("Malformed keyword \"" + line.trimmed().toStdString() + "\".");
+            const QString name = line.mid(1, nameEnd - 1).simplified().toLower();
+            const QString value = line.mid(nameEnd + 1).trimmed();
+
+            bool ok = true;
+            if (name == "version")
+            {
+                header.version = value.toDouble(&ok);
+            }
+            else if (name == "number of ports")
+            {
+                header.ports = value.toInt(&ok);
+                ok = ok && header.ports > 0;
+            }
+            else if (name == "number of frequencies")
+            {
+                header.frequencies = value.toInt(&ok);
+                ok = ok && header.frequencies >= 0;
+            }
+            else if (name == "two-port data order")
+            {
+                ok = value == "12_21" || value == "21_12";
+                header.twoPortOrder21_12 = value == "21_12";
+                orderGiven = true;
+            }
+            else if (name == "matrix format")
+            {
+                const QString format = value.toLower();
+                if (format == "full")
+                    header.matrixFormat = SNPHeader::MatrixFormat::Full;
+                else if (format == "lower")
+                    header.matrixFormat = SNPHeader::MatrixFormat::Lower;
+                else if (format == "upper")
+                    header.matrixFormat = SNPHeader::MatrixFormat::Upper;
+                else
+                    ok = false;
+            }
+            else if (name == "reference")
+            {
+                // impedances may continue on the following lines
+                if (header.ports == 0)
+                    throw std::domain_error("[Reference] has to follow [Number of Ports].");
+                for (const QString& token : value.split(QRegExp("\\s+"), QString::SkipEmptyParts))
+                {
+                    bool numberOk;
+                    header.references.push_back(token.toDouble(&numberOk));
+                    ok = ok && numberOk;
+                }
+                while (ok && header.references.size() < header.ports)
+                {
+                    qreal reference;
+                    ok = readNumber(reference);
+                    header.references.push_back(reference);
+                }
+            }
+            else if (name == "mixed-mode order")
+            {
+                throw std::domain_error("Mixed-mode network data is not supported.");
+            }
+            else if (name == "begin information")
+            {
+                while (!atEnd() && !readLine().toLower().contains("[end information]"))
+                    ;
+            }
+            else if (name == "network data")
+            {
+                endAtNextKeyword();
+                break;
+            }
+            else if (name == "end" || name == "noise data")
+            {
+                // a file without network data
+                end = pos;
+                break;
+            }
+            // other keywords do not affect network data
+
+            if (!ok)
+                throw std::domain_error("Incorrect value of [" + name.toStdString() + "].");
+        }
+        else
+        {
+            // network data of a version 1 file
+            break;
+        }
+    }
+
+    if (header.version >= 2 && !orderGiven)
+        header.twoPortOrder21_12 = false;
+
+    return header;
+}
+
+QByteArray SNPParser::readLine()
+{
+    const char* lineEnd = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    lineEnd = lineEnd ? lineEnd + 1 : end;
+
+    QByteArray line(pos, static_cast<int>(lineEnd - pos));
+    pos = lineEnd;
+
+    // behave like a device opened in text mode
+    if (line.endsWith("\r\n"))
+        line.remove(line.size() - 2, 1);
+    return line;
+}
+
+qint64 SNPParser::countNumbers() const
+{
+    qint64 count = 0;
+    const char* p = pos;
+    while (p != end)
+    {
+        if (isSpace(*p))
+        {
+            ++p;
+            continue;
+        }
+        if (*p == '!')
+        {
+            p = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!p)
+                break;
+            continue;
+        }
+        ++count;
+        while (p != end && !isSpace(*p) && *p != '!')
+            ++p;
+    }
+    return count;
+}
+
+bool SNPParser::readNumber(qreal& value)
+{
+    if (!findNumber())
+        return false;
+
+    const char* next = parseNumber(pos, end, value);
+    if (!next)
+        throw std::runtime_error("Malformed number in data section at offset " +
+                                 std::to_string(offset()) + ".");
+    pos = next;
+    return true;
+}
+
+std::vector<SNPParser> SNPParser::split(int pieces) const
+{
+    std::vector<SNPParser> result;
+
+    // pieces keep the original begin, so offsets in errors are still file offsets
+    const char* first = pos;
+    for (int i = 1; i < pieces && first != end; ++i)
+    {
+        const char* guess = pos + (end - pos) * i / pieces;
+        if (guess < first)
+            continue;
+        const char* lineEnd = static_cast<const char*>(std::memchr(guess, '\n', end - guess));
+        const char* next = lineEnd ? lineEnd + 1 : end;
+        result.push_back(SNPParser(begin, first, next));
+        first = next;
+    }
+    if (first != end || result.empty())
+        result.push_back(SNPParser(begin, first, end));
+
+    return result;
+}
+
+const char* SNPParser::parseNumber(const char* first, const char* last, qreal& value)
+{
+    const char* p = first;
+
+    bool negative = false;
+    if (p != last && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        ++p;
+    }
+
+    // all significant digits are collected into one integer,
+    // the decimal point only shifts the exponent
+    quint64 mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool truncated = false;
+    bool anyDigits = false;
+
+    const auto addDigit =
+    [&](int digit, bool fractional)
+    {
+        anyDigits = true;
+        if (mantissa == 0 && digit == 0)
+        {
+            // leading zeros carry no precision
+            if (fractional)
+                --exponent;
+            return;
+        }
+        if (digits < MAX_MANTISSA_DIGITS)
+        {
+            mantissa = mantissa * 10 + digit;
+            ++digits;
+            if (fractional)
+                --exponent;
+        }
+        else
+        {
+            truncated = truncated || digit != 0;
+            if (!fractional)
+                ++exponent;
+        }
+    };
+
+    while (p != last && isDigit(*p))
+        addDigit(*p++ - '0', false);
+
+    if (p != last && *p == '.')
+    {
+        ++p;
+        while (p != last && isDigit(*p))
+            addDigit(*p++ - '0', true);
+    }
+
+    if (!anyDigits)
+        return nullptr;
+
+    if (p != last && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        bool negativeExp = false;
+        if (p != last && (*p == '-' || *p == '+'))
+        {
+            negativeExp = *p == '-';
+            ++p;
+        }
+        if (p == last || !isDigit(*p))
+            return nullptr;
+
+        int expValue = 0;
+        while (p != last && isDigit(*p))
+        {
+            // bigger exponents are out of double range anyway
+            if (expValue < 100000)
+                expValue = expValue * 10 + (*p - '0');
+            ++p;
+        }
+        exponent += negativeExp ? -expValue : expValue;
+    }
+
+    // the number has to be a whole token
+    if (p != last && !isSpace(*p) && *p != '!')
+        return nullptr;
+
+    if (mantissa == 0)
+    {
+        value = negative ? -0.0 : 0.0;
+        return p;
+    }
+
+    // fast path: both the mantissa and the power of ten are exact,
+    // so a single multiplication or division is correctly rounded
+    if (!truncated && mantissa <= MAX_EXACT_MANTISSA &&
+        exponent >= -MAX_EXACT_POWER && exponent <= MAX_EXACT_POWER)
+    {
+        double result = static_cast<double>(mantissa);
+        if (exponent < 0)
+            result /= EXACT_POWERS_OF_10[-exponent];
+        else
+            result *= EXACT_POWERS_OF_10[exponent];
+        value = negative ? -result : result;
+        return p;
+    }
+
+    // rare long or extreme numbers go through Qt's locale-free conversion
+    bool ok;
+    value = QByteArray::fromRawData(first, static_cast<int>(p - first)).toDouble(&ok);
+    return ok ? p : nullptr;
+}
+
+void SNPParser::endAtNextKeyword()
+{
+    const char* p = pos;
+    forever
+    {
+        const char* bracket = static_cast<const char*>(std::memchr(p, '[', end - p));
+        if (!bracket)
+            return;
+
+        // a keyword is the first token of its line, brackets in comments do not count
+        const char* lineStart = bracket;
+        while (lineStart != pos && (*(lineStart - 1) == ' ' || *(lineStart - 1) == '\t'))
+            --lineStart;
+        if (lineStart == pos || *(lineStart - 1) == '\n')
+        {
+            end = lineStart;
+            return;
+        }
+        p = bracket + 1;
+    }
+}
+
+void SNPParser::skipToken()
+{
+    while (pos != end && !isSpace(*pos) && *pos != '!')
+        ++pos;
+}
+
+bool SNPParser::findNumber()
+{
+    while (pos != end)
+    {
+        if (isSpace(*pos))
+        {
+            ++pos;
+        }
+        else if (*pos == '!')
+        {
+            const char* lineEnd = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+            pos = lineEnd ? lineEnd : end;
+        }
+        else
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,138 @@
+#ifndef SNPPARSER_H
+#define SNPPARSER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtGlobal>
+
+#include <vector>
+
+// Settings from the "# <frequency unit> <parameter> <format> R <z0>" line.
+// Missing values keep the Touchstone defaults: GHz, S, MA, 50 Ohm.
+struct SNPOptions
+{
+    enum class Parameter { S, Y, Z, H, G };
+    enum class Format { RI, MA, DB };
+
+    // multiplier that converts file frequencies to Hz
+    qreal frequencyScale = 1e9;
+    Parameter parameter = Parameter::S;
+    Format format = Format::MA;
+    qreal z0 = 50;
+
+    // throws std::domain_error on unknown or malformed options
+    static SNPOptions parse(QString line);
+};
+
+// Everything in front of the network data.
+// Touchstone 2.0 keywords keep defaults of version 1 files when missing.
+struct SNPHeader
+{
+    enum class MatrixFormat { Full, Lower, Upper };
+
+    // comment lines at the beginning of the file
+    QStringList description;
+    QString optionLine;
+    SNPOptions options;
+
+    qreal version = 1;
+    // 0 if the number of ports comes from the file extension
+    int ports = 0;
+    // -1 if the number of frequencies is not known in advance
+    int frequencies = -1;
+    MatrixFormat matrixFormat = MatrixFormat::Full;
+    // 2-port data of version 1 files comes as S11 S21 S12 S22
+    bool twoPortOrder21_12 = true;
+    // impedances of every port, empty if only R of the option line is given
+    QVector<qreal> references;
+};
+
+// Reads Touchstone text straight from memory (usually a mapped file).
+// Numbers are converted without QTextStream and without the C locale,
+// so parsing is not slowed down by stream state or per-token allocations.
+class SNPParser
+{
+// PRIVATE FIELDS
+private:
+    const char* begin;
+    const char* end;
+    const char* pos;
+
+// PUBLIC METHODS
+public:
+    SNPParser(const char* begin_, const char* end_);
+
+    bool atEnd() const
+    {
+        return pos == end;
+    }
+
+    qint64 offset() const
+    {
+        return pos - begin;
+    }
+
+    // size of the data left
+    qint64 remaining() const
+    {
+        return end - pos;
+    }
+
+    // returns first char of the current line or 0 if there is no data left
+    char peek() const;
+
+    // skips spaces and empty lines, returns the next char or 0 at the end
+    char skipBlank();
+
+    // reads comments, the option line and Touchstone 2.0 keywords,
+    // stops at the first number of network data
+    // for version 2 files the data ends at the keyword after [Network Data]
+    // throws std::domain_error on malformed or unsupported keywords
+    SNPHeader readHeader();
+
+    // returns the rest of the current line including its terminator
+    QByteArray readLine();
+
+    // counts the numbers left in the data, '!' comments are skipped
+    qint64 countNumbers() const;
+
+    // reads the next number, returns false if there are no numbers left
+    // throws std::runtime_error if the next token is not a number
+    bool readNumber(qreal& value);
+
+    // moves to the next number without reading it, returns false if there are none
+    bool findNumber();
+
+    // moves past the current token without converting it
+    void skipToken();
+
+    // moves to a position returned by offset()
+    void seek(qint64 offset_)
+    {
+        pos = begin + offset_;
+    }
+
+    // splits the rest of data into at most `pieces` parsers
+    // every piece starts at a line boundary, so comments are never cut
+    std::vector<SNPParser> split(int pieces) const;
+
+    // converts the number at the beginning of [first, last)
+    // returns pointer past the number or nullptr if it is malformed
+    static const char* parseNumber(const char* first, const char* last, qreal& value);
+
+    static bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+// PRIVATE METHODS
+private:
+    SNPParser(const char* begin_, const char* pos_, const char* end_);
+
+    // ends the data at the next line that starts with a keyword
+    void endAtNextKeyword();
+};
+
+#endif // SNPPARSER_H
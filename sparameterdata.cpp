@@ -0,0 +1,108 @@
+#include "sparameterdata.h"
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+std::shared_ptr<Sample> SParameterData::allocateAligned(qint64 samples)
+{
+    const std::size_t bytes = samples * sizeof(Sample) + SParameterData::ALIGNMENT;
+    void* raw = std::malloc(bytes);
+    if (!raw)
+        throw std::bad_alloc();
+
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(raw);
+    address = (address + SParameterData::ALIGNMENT - 1) / SParameterData::ALIGNMENT * SParameterData::ALIGNMENT;
+    return std::shared_ptr<Sample>(reinterpret_cast<Sample*>(address), [raw](Sample*) { std::free(raw); });
+}
+
+SParameterData::SParameterData()
+    : dimension(0)
+    , points(0)
+    , symmetric(false)
+    , stride(0)
+    , planes(std::make_shared<Planes>())
+{
+}
+
+SParameterData::SParameterData(int dimension_, int points_, bool symmetric_, Allocation allocation)
+    : dimension(dimension_)
+    , points(points_)
+    , symmetric(symmetric_)
+    , stride(planeStride(points_))
+    , planes(std::make_shared<Planes>())
+{
+    if (allocation == Allocation::Contiguous)
+    {
+        buffer = allocateAligned(planeCount() * stride);
+        mapPlanes();
+    }
+    else
+    {
+        planes->real.assign(getParameterCount(), nullptr);
+        planes->blocks.resize(getParameterCount());
+    }
+}
+
+SParameterData::SParameterData(int dimension_, int points_, bool symmetric_, std::shared_ptr<Sample> buffer_)
+    : dimension(dimension_)
+    , points(points_)
+    , symmetric(symmetric_)
+    , stride(planeStride(points_))
+    , buffer(std::move(buffer_))
+    , planes(std::make_shared<Planes>())
+{
+    mapPlanes();
+}
+
+void SParameterData::allocateParameter(int index)
+{
+    if (hasParameter(index))
+        return;
+    planes->blocks[index] = allocateAligned(2 * stride);
+    planes->real[index] = planes->blocks[index].get();
+}
+
+SParameterData SParameterData::slice(int first, int count) const
+{
+    SParameterData result(dimension, count, symmetric);
+    for (int i = 0; i < getParameterCount(); ++i)
+    {
+        std::memcpy(result.real(i), real(i) + first, count * sizeof(Sample));
+        std::memcpy(result.imag(i), imag(i) + first, count * sizeof(Sample));
+    }
+    return result;
+}
+
+SParameterData SParameterData::select(const std::vector<int>& points) const
+{
+    const int count = static_cast<int>(points.size());
+    SParameterData result(dimension, count, symmetric);
+    for (int i = 0; i < getParameterCount(); ++i)
+    {
+        const Sample* re = real(i);
+        const Sample* im = imag(i);
+        Sample* selectedRe = result.real(i);
+        Sample* selectedIm = result.imag(i);
+        for (int point = 0; point < count; ++point)
+        {
+            selectedRe[point] = re[points[point]];
+            selectedIm[point] = im[points[point]];
+        }
+    }
+    return result;
+}
+
+void SParameterData::mapPlanes()
+{
+    planes->real.resize(getParameterCount());
+    for (int i = 0; i < getParameterCount(); ++i)
+        planes->real[i] = buffer.get() + 2 * i * stride;
+}
+
+qint64 SParameterData::planeStride(int points_)
+{
+    const qint64 samplesPerLine = ALIGNMENT / sizeof(Sample);
+    return (points_ + samplesPerLine - 1) / samplesPerLine * samplesPerLine;
+}
@@ -0,0 +1,196 @@
+#ifndef SPARAMETERDATA_H
+#define SPARAMETERDATA_H
+
+#include <QtGlobal>
+
+#include <complex>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Type of stored samples. Measured data rarely needs more than single
+// precision, building with CONFIG += float_samples halves the memory
+// taken by samples. Frequencies are always kept in qreal.
+#ifdef SNP_FLOAT_SAMPLES
+typedef float Sample;
+#else
+typedef qreal Sample;
+#endif
+
+// Read-only view of one network parameter over all frequency points.
+// Real and imaginary parts are separate contiguous arrays.
+struct ParameterSpan
+{
+    const Sample* real;
+    const Sample* imag;
+    int size;
+
+    // promoted to qreal, so math on samples keeps full precision
+    std::complex<qreal> operator[](int point) const
+    {
+        return {real[point], imag[point]};
+    }
+};
+
+// Samples of an N-port network in one aligned buffer.
+// Every parameter owns two planes (real and imaginary parts), each plane
+// is padded to a cache line, so loops over a plane can be vectorized.
+// Copies share the buffer: it is filled once while loading and is not
+// modified after that.
+// Symmetric data (reciprocal networks given as an upper or lower matrix)
+// keeps only the lower triangle, Sij and Sji share one parameter.
+// With OnDemand allocation every parameter gets its own block when it is
+// first decoded; copies share these blocks as well.
+class SParameterData
+{
+// PUBLIC TYPES
+public:
+    enum class Allocation { Contiguous, OnDemand };
+
+// PRIVATE TYPES
+private:
+    struct Planes
+    {
+        // real plane of every parameter, the imaginary one is stride after it
+        // null for parameters that are not allocated yet
+        std::vector<Sample*> real;
+        // blocks of parameters allocated on demand
+        std::vector<std::shared_ptr<Sample>> blocks;
+    };
+
+// PRIVATE FIELDS
+private:
+    int dimension;
+    int points;
+    bool symmetric;
+    // distance between planes in samples
+    qint64 stride;
+    // contiguous storage of all parameters, null with OnDemand allocation
+    std::shared_ptr<Sample> buffer;
+    std::shared_ptr<Planes> planes;
+
+// PUBLIC METHODS
+public:
+    // planes are aligned to this number of bytes
+    static const int ALIGNMENT = 64;
+
+    SParameterData();
+
+    // allocates uninitialized storage for all parameters,
+    // or only prepares the table of parameters for OnDemand allocation
+    SParameterData(int dimension_, int points_, bool symmetric_ = false,
+                   Allocation allocation = Allocation::Contiguous);
+
+    // adopts existing storage with the same layout, e.g. a mapped cache entry
+    // buffer_ has to be aligned and hold planeCount() * planeStride() samples
+    SParameterData(int dimension_, int points_, bool symmetric_, std::shared_ptr<Sample> buffer_);
+
+    int getDimension() const
+    {
+        return dimension;
+    }
+
+    int getPointCount() const
+    {
+        return points;
+    }
+
+    bool isSymmetric() const
+    {
+        return symmetric;
+    }
+
+    // number of stored parameters
+    int getParameterCount() const
+    {
+        return symmetric ? dimension * (dimension + 1) / 2 : dimension * dimension;
+    }
+
+    int planeCount() const
+    {
+        return 2 * getParameterCount();
+    }
+
+    qint64 planeStride() const
+    {
+        return stride;
+    }
+
+    static qint64 planeStride(int points_);
+
+    // uninitialized storage of samples aligned like the planes
+    static std::shared_ptr<Sample> allocateAligned(qint64 samples);
+
+    // whole buffer, planeCount() * planeStride() samples
+    // null if parameters are allocated on demand
+    const Sample* data() const
+    {
+        return buffer.get();
+    }
+
+    bool isContiguous() const
+    {
+        return buffer != nullptr;
+    }
+
+    bool hasParameter(int index) const
+    {
+        return planes->real[index] != nullptr;
+    }
+
+    // allocates uninitialized planes of a parameter that has none yet
+    void allocateParameter(int index);
+
+    // copy of points [first, first + count) in new contiguous storage,
+    // all parameters have to be allocated
+    SParameterData slice(int first, int count) const;
+    // copy of the given points in their order in new contiguous storage,
+    // all parameters have to be allocated
+    SParameterData select(const std::vector<int>& points) const;
+
+    // index of parameter S(row + 1)(column + 1)
+    int parameterIndex(int row, int column) const
+    {
+        if (!symmetric)
+            return row * dimension + column;
+        if (row < column)
+            std::swap(row, column);
+        return row * (row + 1) / 2 + column;
+    }
+
+    ParameterSpan parameter(int index) const
+    {
+        return {real(index), imag(index), points};
+    }
+
+    ParameterSpan parameter(int row, int column) const
+    {
+        return parameter(parameterIndex(row, column));
+    }
+
+    const Sample* real(int index) const
+    {
+        return planes->real[index];
+    }
+    const Sample* imag(int index) const
+    {
+        return planes->real[index] + stride;
+    }
+
+    // only for filling freshly allocated storage
+    Sample* real(int index)
+    {
+        return planes->real[index];
+    }
+    Sample* imag(int index)
+    {
+        return planes->real[index] + stride;
+    }
+
+// PRIVATE METHODS
+private:
+    // points planes of all parameters into buffer
+    void mapPlanes();
+};
+
+#endif // SPARAMETERDATA_H